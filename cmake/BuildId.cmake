@@ -0,0 +1,31 @@
+# CMake script writing the build identity header for mesh_sim.
+#
+# Run at build time (cmake -P), so the git description is current
+# rather than that of the last configure.  The header is only rewritten
+# if it changed, to avoid needless recompiles.
+#
+# Variables:
+# - SOURCE_DIR:  source tree to describe
+# - OUTPUT:  header file to write
+# - COMPILER, BUILD_TYPE:  recorded as given
+
+execute_process(
+	COMMAND git describe --always --dirty --tags
+	WORKING_DIRECTORY "${SOURCE_DIR}"
+	OUTPUT_VARIABLE git_describe
+	OUTPUT_STRIP_TRAILING_WHITESPACE
+	ERROR_QUIET
+	RESULT_VARIABLE git_result)
+if (NOT git_result EQUAL 0 OR git_describe STREQUAL "")
+	set(git_describe "unknown")
+endif()
+if (BUILD_TYPE STREQUAL "")
+	set(BUILD_TYPE "none")
+endif()
+
+file(WRITE "${OUTPUT}.tmp"
+	"#define MESHSIM_GIT_DESCRIBE \"${git_describe}\"\n"
+	"#define MESHSIM_COMPILER \"${COMPILER}\"\n"
+	"#define MESHSIM_BUILD_TYPE \"${BUILD_TYPE}\"\n")
+configure_file("${OUTPUT}.tmp" "${OUTPUT}" COPYONLY)
+file(REMOVE "${OUTPUT}.tmp")
@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <typeinfo>
+
+#include "ns3/event-impl.h"
+#include "ns3/log.h"
+#include "ns3/object-factory.h"
+#include "ns3/string.h"
+
+#include "counting-scheduler.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("CountingScheduler");
+
+NS_OBJECT_ENSURE_REGISTERED (CountingScheduler);
+
+uint64_t CountingScheduler::s_inserted = 0;
+uint64_t CountingScheduler::s_removed = 0;
+uint64_t CountingScheduler::s_size = 0;
+uint64_t CountingScheduler::s_peakSize = 0;
+bool CountingScheduler::s_countTypes = false;
+CountingScheduler::TypeCounts CountingScheduler::s_typeCounts;
+const std::type_info* CountingScheduler::s_lastType = NULL;
+uint64_t* CountingScheduler::s_lastCount = NULL;
+
+TypeId
+CountingScheduler::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::CountingScheduler")
+    .SetParent<Scheduler> ()
+    .SetGroupName ("Core")
+    .AddConstructor<CountingScheduler> ()
+    .AddAttribute ("SchedulerType",
+                   "Type of the scheduler doing the actual work.",
+                   StringValue ("ns3::MapScheduler"),
+                   MakeStringAccessor (&CountingScheduler::m_schedulerType),
+                   MakeStringChecker ())
+  ;
+  return tid;
+}
+
+CountingScheduler::CountingScheduler ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+CountingScheduler::~CountingScheduler ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+CountingScheduler::NotifyConstructionCompleted (void)
+{
+  NS_LOG_FUNCTION (this);
+  ObjectFactory factory;
+  factory.SetTypeId (m_schedulerType);
+  m_scheduler = factory.Create<Scheduler> ();
+  Scheduler::NotifyConstructionCompleted ();
+}
+
+void
+CountingScheduler::Insert (const Event &ev)
+{
+  m_scheduler->Insert (ev);
+  ++s_inserted;
+  s_peakSize = std::max (s_peakSize, ++s_size);
+}
+
+bool
+CountingScheduler::IsEmpty (void) const
+{
+  return m_scheduler->IsEmpty ();
+}
+
+Scheduler::Event
+CountingScheduler::PeekNext (void) const
+{
+  return m_scheduler->PeekNext ();
+}
+
+Scheduler::Event
+CountingScheduler::RemoveNext (void)
+{
+  Event ev = m_scheduler->RemoveNext ();
+  --s_size;
+  if (s_countTypes)
+    {
+      // Events of the same type often come in runs.  The elements of
+      // an unordered_map don't move, so the counter can be kept.
+      const std::type_info* type = &typeid (*ev.impl);
+      if (type != s_lastType)
+        {
+          s_lastType = type;
+          s_lastCount = &s_typeCounts[type];
+        }
+      ++*s_lastCount;
+    }
+  return ev;
+}
+
+void
+CountingScheduler::Remove (const Event &ev)
+{
+  m_scheduler->Remove (ev);
+  ++s_removed;
+  --s_size;
+}
+
+uint64_t
+CountingScheduler::GetInserted (void)
+{
+  return s_inserted;
+}
+
+uint64_t
+CountingScheduler::GetRemoved (void)
+{
+  return s_removed;
+}
+
+uint64_t
+CountingScheduler::GetSize (void)
+{
+  return s_size;
+}
+
+uint64_t
+CountingScheduler::GetPeakSize (void)
+{
+  return s_peakSize;
+}
+
+void
+CountingScheduler::EnableTypeCounts (void)
+{
+  s_countTypes = true;
+}
+
+const CountingScheduler::TypeCounts &
+CountingScheduler::GetTypeCounts (void)
+{
+  return s_typeCounts;
+}
+
+} // namespace ns3
+
+// vim:sw=2:sts=2:et
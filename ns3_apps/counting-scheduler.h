@@ -0,0 +1,92 @@
+#ifndef COUNTING_SCHEDULER_H
+#define COUNTING_SCHEDULER_H
+
+#include <string>
+#include <typeinfo>
+#include <unordered_map>
+
+#include "ns3/scheduler.h"
+
+namespace ns3 {
+
+/**
+ * \brief Event scheduler wrapper keeping statistics
+ *
+ * Passes everything on to a scheduler of type SchedulerType, and
+ * counts insertions, cancellations and the peak number of pending
+ * events.  Optionally, it also counts the events run per EventImpl
+ * type, which tells what scheduled them.  There is a single simulator
+ * per process, so the counts are kept in static members, where they
+ * can be read after the run.
+ */
+class CountingScheduler : public Scheduler
+{
+public:
+  /// Keyed by the address of the type_info, which is cheap to hash
+  /// on every event; look the names up only when reporting
+  typedef std::unordered_map<const std::type_info*, uint64_t> TypeCounts;
+
+  static TypeId GetTypeId (void);
+
+  CountingScheduler ();
+  virtual ~CountingScheduler ();
+
+  virtual void Insert (const Event &ev);
+  virtual bool IsEmpty (void) const;
+  virtual Event PeekNext (void) const;
+  virtual Event RemoveNext (void);
+  virtual void Remove (const Event &ev);
+
+  /**
+   * \return the number of events inserted
+   */
+  static uint64_t GetInserted (void);
+
+  /**
+   * \return the number of events removed before they were due
+   */
+  static uint64_t GetRemoved (void);
+
+  /**
+   * \return the number of events pending
+   */
+  static uint64_t GetSize (void);
+
+  /**
+   * \return the largest number of events pending at once
+   */
+  static uint64_t GetPeakSize (void);
+
+  /**
+   * \brief Start counting the events run per EventImpl type
+   */
+  static void EnableTypeCounts (void);
+
+  /**
+   * \return the number of events run (including cancelled ones) per
+   * type of their EventImpl
+   */
+  static const TypeCounts &GetTypeCounts (void);
+
+protected:
+  virtual void NotifyConstructionCompleted (void);
+
+private:
+  std::string m_schedulerType;
+  Ptr<Scheduler> m_scheduler;
+
+  static uint64_t s_inserted;
+  static uint64_t s_removed;
+  static uint64_t s_size;
+  static uint64_t s_peakSize;
+  static bool s_countTypes;
+  static TypeCounts s_typeCounts;
+  static const std::type_info* s_lastType;   //!< Type of the last event
+  static uint64_t* s_lastCount;             //!< Its count
+};
+
+} // namespace ns3
+
+#endif /* COUNTING_SCHEDULER_H */
+
+// vim:sw=2:sts=2:et
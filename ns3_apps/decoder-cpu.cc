@@ -0,0 +1,106 @@
+#include <algorithm>
+
+#include "ns3/double.h"
+#include "ns3/log.h"
+#include "ns3/node.h"
+#include "ns3/simulator.h"
+#include "ns3/uinteger.h"
+
+#include "decoder-cpu.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("DecoderCpu");
+
+NS_OBJECT_ENSURE_REGISTERED (DecoderCpu);
+
+TypeId
+DecoderCpu::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::DecoderCpu")
+    .SetParent<Object> ()
+    .SetGroupName ("Applications")
+    .AddConstructor<DecoderCpu> ()
+    .AddAttribute ("Cores",
+                   "Number of cores decoding in parallel",
+                   UintegerValue (1),
+                   MakeUintegerAccessor (&DecoderCpu::m_cores),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("ClockHz",
+                   "Clock rate of a core",
+                   DoubleValue (1e9),
+                   MakeDoubleAccessor (&DecoderCpu::m_clockHz),
+                   MakeDoubleChecker<double> (1))
+    .AddAttribute ("CyclesPerSymbol",
+                   "Cycles to decode a symbol",
+                   DoubleValue (20000),
+                   MakeDoubleAccessor (&DecoderCpu::m_cyclesPerSymbol),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("CyclesPerSymbolPerK",
+                   "Additional cycles to decode a symbol, per symbol "
+                   "of the source block",
+                   DoubleValue (0),
+                   MakeDoubleAccessor (&DecoderCpu::m_cyclesPerSymbolPerK),
+                   MakeDoubleChecker<double> (0))
+  ;
+  return tid;
+}
+
+DecoderCpu::DecoderCpu ()
+  : m_cores(1),
+    m_clockHz(1e9),
+    m_cyclesPerSymbol(20000),
+    m_cyclesPerSymbolPerK(0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+DecoderCpu::~DecoderCpu ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+Ptr<DecoderCpu> DecoderCpu::GetOrCreate (Ptr<Node> node)
+{
+  Ptr<DecoderCpu> cpu = node->GetObject<DecoderCpu> ();
+  if (!cpu) {
+    cpu = CreateObject<DecoderCpu> ();
+    node->AggregateObject (cpu);
+  }
+  return cpu;
+}
+
+Time DecoderCpu::GetDecodeTime (uint32_t k) const
+{
+  const double cycles = k * (m_cyclesPerSymbol + m_cyclesPerSymbolPerK * k);
+  return Seconds (cycles / m_clockHz);
+}
+
+void DecoderCpu::Submit (uint32_t k, uint32_t id,
+                         Callback<void, uint32_t, Time, Time> done)
+{
+  NS_LOG_FUNCTION (this << k << id);
+  if (m_coreFreeAt.size () != m_cores)
+    m_coreFreeAt.resize (m_cores, Seconds (0));
+
+  // The core that is free first takes the block
+  const Time now = Simulator::Now ();
+  std::vector<Time>::iterator core
+    = std::min_element (m_coreFreeAt.begin (), m_coreFreeAt.end ());
+  const Time start = std::max (*core, now);
+  const Time decoding = GetDecodeTime (k);
+  *core = start + decoding;
+
+  Simulator::Schedule (*core - now, &DecoderCpu::Finish, done, id,
+                       start - now, decoding);
+}
+
+void DecoderCpu::Finish (Callback<void, uint32_t, Time, Time> done,
+                         uint32_t id, Time queueing, Time decoding)
+{
+  done (id, queueing, decoding);
+}
+
+} // namespace ns3
+
+// vim:set et:sts=2:sw=2
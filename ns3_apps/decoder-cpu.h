@@ -0,0 +1,69 @@
+#ifndef DECODER_CPU_H
+#define DECODER_CPU_H
+
+#include <vector>
+
+#include "ns3/callback.h"
+#include "ns3/nstime.h"
+#include "ns3/object.h"
+
+namespace ns3 {
+
+class Node;
+
+/**
+ * \brief CPU of a node decoding source blocks
+ *
+ * Decoding a source block of K symbols takes
+ * K * (CyclesPerSymbol + CyclesPerSymbolPerK * K) cycles at ClockHz,
+ * i.e., the cost per symbol may grow with K, as it does for Gaussian
+ * elimination.  The node has Cores cores, which all decoders on the
+ * node share:  a block is decoded by the first core that becomes free,
+ * and waits for one in FIFO order.
+ */
+class DecoderCpu : public Object
+{
+public:
+  static TypeId GetTypeId (void);
+
+  DecoderCpu ();
+  virtual ~DecoderCpu ();
+
+  /**
+   * \brief Get the CPU of node, aggregating one with the default
+   * attributes to it if it has none yet
+   */
+  static Ptr<DecoderCpu> GetOrCreate (Ptr<Node> node);
+
+  /**
+   * \return the time a core takes to decode a block of k symbols
+   */
+  Time GetDecodeTime (uint32_t k) const;
+
+  /**
+   * \brief Queue the decoding of a block of k symbols
+   * \param id identifies the block to done, as blocks may finish out
+   * of order on several cores
+   * \param done called with id, the queueing delay and the decoding
+   * time once the block is decoded
+   */
+  void Submit (uint32_t k, uint32_t id,
+               Callback<void, uint32_t, Time, Time> done);
+
+private:
+  static void Finish (Callback<void, uint32_t, Time, Time> done,
+                      uint32_t id, Time queueing, Time decoding);
+
+  uint32_t m_cores;                  //!< Number of cores
+  double m_clockHz;                  //!< Clock rate of a core
+  double m_cyclesPerSymbol;          //!< Cycles per symbol
+  double m_cyclesPerSymbolPerK;      //!< Extra cycles per symbol and K
+
+  std::vector<Time> m_coreFreeAt;    //!< When each core is done
+};
+
+} // namespace ns3
+
+#endif /* DECODER_CPU_H */
+
+// vim:set et:sts=2:sw=2
@@ -0,0 +1,171 @@
+#include <string.h>
+#include <algorithm>
+
+#include "fountain-code.h"
+#include "gf256.h"
+
+namespace ns3 {
+
+FountainCode::FountainCode (uint32_t k)
+  : m_k(k)
+{
+}
+
+uint32_t FountainCode::GetK (void) const
+{
+  return m_k;
+}
+
+/** xorshift64*, seeded with the ESI and K, a byte at a time */
+class CoefficientGenerator
+{
+public:
+  CoefficientGenerator (uint32_t esi, uint32_t k)
+    : m_x((esi + 1) * 0x9e3779b97f4a7c15ULL ^ k),
+      m_r(0),
+      m_left(0)
+  {
+  }
+
+  uint8_t Next (void)
+  {
+    if (m_left == 0) {
+      m_x ^= m_x >> 12;
+      m_x ^= m_x << 25;
+      m_x ^= m_x >> 27;
+      m_r = m_x * 0x2545f4914f6cdd1dULL;
+      m_left = 8;
+    }
+    const uint8_t c = uint8_t(m_r);
+    m_r >>= 8;
+    --m_left;
+    return c;
+  }
+
+private:
+  uint64_t m_x;
+  uint64_t m_r;
+  int m_left;
+};
+
+void FountainCode::GetCoefficients (uint32_t esi, uint8_t *coefs) const
+{
+  if (esi < m_k) {
+    memset (coefs, 0, m_k);
+    coefs[esi] = 1;
+    return;
+  }
+  CoefficientGenerator gen (esi, m_k);
+  for (uint32_t i = 0; i < m_k; ++i)
+    coefs[i] = gen.Next ();
+}
+
+void FountainCode::Encode (uint32_t esi, const uint8_t *const *source,
+                           uint8_t *symbol, size_t t) const
+{
+  if (esi < m_k) {
+    memcpy (symbol, source[esi], t);
+    return;
+  }
+  CoefficientGenerator gen (esi, m_k);
+  memset (symbol, 0, t);
+  for (uint32_t i = 0; i < m_k; ++i)
+    Gf256::MulAddRegion (symbol, source[i], gen.Next (), t);
+}
+
+FountainDecoder::FountainDecoder (uint32_t k, size_t t)
+  : m_code(k),
+    m_k(k),
+    m_t(t),
+    m_rank(0),
+    m_rows(size_t(k) * k),
+    m_data(size_t(k) * t),
+    m_hasPivot(k, false),
+    m_coefs(k),
+    m_symbol(t)
+{
+}
+
+void FountainDecoder::Reset (void)
+{
+  m_rank = 0;
+  std::fill (m_hasPivot.begin (), m_hasPivot.end (), false);
+}
+
+bool FountainDecoder::AddSymbol (uint32_t esi, const uint8_t *data)
+{
+  if (m_rank == m_k)
+    return false;
+
+  uint8_t *v = m_coefs.data ();
+  m_code.GetCoefficients (esi, v);
+  if (m_t > 0)
+    memcpy (m_symbol.data (), data, m_t);
+
+  /* Eliminate the pivot columns; the first other column with a
+   * nonzero coefficient becomes the pivot of the symbol.
+   */
+  for (uint32_t col = 0; col < m_k; ++col) {
+    const uint8_t c = v[col];
+    if (c == 0)
+      continue;
+    if (m_hasPivot[col]) {
+      Gf256::MulAddRegion (v + col, &m_rows[size_t(col) * m_k + col], c,
+                           m_k - col);
+      if (m_t > 0)
+        Gf256::MulAddRegion (m_symbol.data (), &m_data[col * m_t], c, m_t);
+      continue;
+    }
+
+    const uint8_t inv = Gf256::Inv (c);
+    uint8_t *row = &m_rows[size_t(col) * m_k];
+    memset (row, 0, col);
+    memcpy (row + col, v + col, m_k - col);
+    Gf256::MulRegion (row + col, inv, m_k - col);
+    if (m_t > 0) {
+      memcpy (&m_data[col * m_t], m_symbol.data (), m_t);
+      Gf256::MulRegion (&m_data[col * m_t], inv, m_t);
+    }
+    m_hasPivot[col] = true;
+    ++m_rank;
+    return true;
+  }
+  return false;
+}
+
+uint32_t FountainDecoder::GetRank (void) const
+{
+  return m_rank;
+}
+
+bool FountainDecoder::IsDecodable (void) const
+{
+  return m_rank == m_k;
+}
+
+bool FountainDecoder::Decode (uint8_t *const *source)
+{
+  if (m_rank != m_k || m_t == 0)
+    return false;
+
+  /* The rows are upper triangular with a unit diagonal; substitute
+   * back from the last column.
+   */
+  for (uint32_t col = m_k; col-- > 0; ) {
+    for (uint32_t r = 0; r < col; ++r) {
+      uint8_t *row = &m_rows[size_t(r) * m_k];
+      const uint8_t c = row[col];
+      if (c == 0)
+        continue;
+      row[col] = 0;
+      Gf256::MulAddRegion (&m_data[r * m_t], &m_data[col * m_t], c, m_t);
+    }
+  }
+  for (uint32_t i = 0; i < m_k; ++i)
+    memcpy (source[i], &m_data[i * m_t], m_t);
+  return true;
+}
+
+} // namespace ns3
+
+// vim:set et:sts=2:sw=2
@@ -0,0 +1,99 @@
+#ifndef FOUNTAIN_CODE_H
+#define FOUNTAIN_CODE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief Systematic random linear fountain code over GF(256)
+ *
+ * A source block has K source symbols of T bytes.  The symbols with
+ * ESI < K are the source symbols themselves; a repair symbol with
+ * ESI >= K is a linear combination of all source symbols, with
+ * coefficients drawn from a pseudo random generator seeded with the
+ * ESI, so that the decoder can rebuild them from the ESI alone.  Like
+ * RaptorQ, a block with K received symbols fails to decode with a
+ * probability of about 1/256, and one more symbol reduces that by
+ * another factor of 256.
+ */
+class FountainCode
+{
+public:
+  FountainCode (uint32_t k);
+
+  uint32_t GetK (void) const;
+
+  /**
+   * \brief Coefficients of the symbol esi over the source symbols
+   * \param coefs K bytes are written here
+   */
+  void GetCoefficients (uint32_t esi, uint8_t *coefs) const;
+
+  /**
+   * \brief Encode the symbol esi from the K source symbols of t bytes
+   */
+  void Encode (uint32_t esi, const uint8_t *const *source, uint8_t *symbol,
+               size_t t) const;
+
+private:
+  uint32_t m_k;
+};
+
+/**
+ * \brief Incremental Gaussian elimination decoder for a FountainCode
+ *
+ * Each received symbol is reduced against the ones before as it
+ * arrives, so the decoder always knows whether the block can be
+ * decoded.  With a symbol size of 0, only the coefficients are kept;
+ * this is enough to tell decoding success from the received ESIs.
+ */
+class FountainDecoder
+{
+public:
+  FountainDecoder (uint32_t k, size_t t);
+
+  /** Forget all received symbols, for the next block */
+  void Reset (void);
+
+  /**
+   * \brief Add the symbol esi
+   * \param data the T bytes of the symbol (ignored if T is 0)
+   * \return whether the symbol was innovative, i.e., increased the rank
+   */
+  bool AddSymbol (uint32_t esi, const uint8_t *data);
+
+  /** Number of linearly independent symbols received */
+  uint32_t GetRank (void) const;
+
+  bool IsDecodable (void) const;
+
+  /**
+   * \brief Recover the source symbols (needs a decodable block and T > 0)
+   * \param source the K source symbols of T bytes are written here
+   */
+  bool Decode (uint8_t *const *source);
+
+private:
+  FountainCode m_code;
+  uint32_t m_k;
+  size_t m_t;
+  uint32_t m_rank;
+
+  /** Row with its pivot in column i, with 1 there, or empty */
+  std::vector<uint8_t> m_rows;   //!< K * K coefficients
+  std::vector<uint8_t> m_data;   //!< K * T symbol data
+  std::vector<bool> m_hasPivot;
+
+  /** Symbol being added */
+  std::vector<uint8_t> m_coefs;
+  std::vector<uint8_t> m_symbol;
+};
+
+} // namespace ns3
+
+#endif /* FOUNTAIN_CODE_H */
+
+// vim:set et:sts=2:sw=2
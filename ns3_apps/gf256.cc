@@ -0,0 +1,260 @@
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define GF256_X86
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define GF256_NEON
+#endif
+
+#include "gf256.h"
+
+namespace ns3 {
+
+/* x^8 + x^4 + x^3 + x^2 + 1 */
+#define GF256_POLY 0x11d
+
+typedef void (*MulAddKernel)(uint8_t *dst, const uint8_t *src,
+                             const uint8_t *lo, const uint8_t *hi, size_t n);
+typedef void (*MulKernel)(uint8_t *dst,
+                          const uint8_t *lo, const uint8_t *hi, size_t n);
+
+static void MulAddScalar (uint8_t *dst, const uint8_t *src,
+                          const uint8_t *lo, const uint8_t *hi, size_t n)
+{
+  for (size_t i = 0; i < n; ++i)
+    dst[i] ^= lo[src[i] & 0x0f] ^ hi[src[i] >> 4];
+}
+
+static void MulScalar (uint8_t *dst,
+                       const uint8_t *lo, const uint8_t *hi, size_t n)
+{
+  for (size_t i = 0; i < n; ++i)
+    dst[i] = lo[dst[i] & 0x0f] ^ hi[dst[i] >> 4];
+}
+
+#ifdef GF256_X86
+__attribute__((target("ssse3")))
+static void MulAddSsse3 (uint8_t *dst, const uint8_t *src,
+                         const uint8_t *lo, const uint8_t *hi, size_t n)
+{
+  const __m128i tlo = _mm_loadu_si128 ((const __m128i*)lo);
+  const __m128i thi = _mm_loadu_si128 ((const __m128i*)hi);
+  const __m128i mask = _mm_set1_epi8 (0x0f);
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    const __m128i x = _mm_loadu_si128 ((const __m128i*)(src + i));
+    const __m128i p = _mm_xor_si128 (
+      _mm_shuffle_epi8 (tlo, _mm_and_si128 (x, mask)),
+      _mm_shuffle_epi8 (thi, _mm_and_si128 (_mm_srli_epi64 (x, 4), mask)));
+    const __m128i d = _mm_loadu_si128 ((const __m128i*)(dst + i));
+    _mm_storeu_si128 ((__m128i*)(dst + i), _mm_xor_si128 (d, p));
+  }
+  MulAddScalar (dst + i, src + i, lo, hi, n - i);
+}
+
+__attribute__((target("ssse3")))
+static void MulSsse3 (uint8_t *dst,
+                      const uint8_t *lo, const uint8_t *hi, size_t n)
+{
+  const __m128i tlo = _mm_loadu_si128 ((const __m128i*)lo);
+  const __m128i thi = _mm_loadu_si128 ((const __m128i*)hi);
+  const __m128i mask = _mm_set1_epi8 (0x0f);
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    const __m128i x = _mm_loadu_si128 ((const __m128i*)(dst + i));
+    _mm_storeu_si128 ((__m128i*)(dst + i), _mm_xor_si128 (
+      _mm_shuffle_epi8 (tlo, _mm_and_si128 (x, mask)),
+      _mm_shuffle_epi8 (thi, _mm_and_si128 (_mm_srli_epi64 (x, 4), mask))));
+  }
+  MulScalar (dst + i, lo, hi, n - i);
+}
+
+__attribute__((target("avx2")))
+static void MulAddAvx2 (uint8_t *dst, const uint8_t *src,
+                        const uint8_t *lo, const uint8_t *hi, size_t n)
+{
+  const __m256i tlo = _mm256_broadcastsi128_si256 (
+    _mm_loadu_si128 ((const __m128i*)lo));
+  const __m256i thi = _mm256_broadcastsi128_si256 (
+    _mm_loadu_si128 ((const __m128i*)hi));
+  const __m256i mask = _mm256_set1_epi8 (0x0f);
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    const __m256i x = _mm256_loadu_si256 ((const __m256i*)(src + i));
+    const __m256i p = _mm256_xor_si256 (
+      _mm256_shuffle_epi8 (tlo, _mm256_and_si256 (x, mask)),
+      _mm256_shuffle_epi8 (thi,
+        _mm256_and_si256 (_mm256_srli_epi64 (x, 4), mask)));
+    const __m256i d = _mm256_loadu_si256 ((const __m256i*)(dst + i));
+    _mm256_storeu_si256 ((__m256i*)(dst + i), _mm256_xor_si256 (d, p));
+  }
+  MulAddSsse3 (dst + i, src + i, lo, hi, n - i);
+}
+
+__attribute__((target("avx2")))
+static void MulAvx2 (uint8_t *dst,
+                     const uint8_t *lo, const uint8_t *hi, size_t n)
+{
+  const __m256i tlo = _mm256_broadcastsi128_si256 (
+    _mm_loadu_si128 ((const __m128i*)lo));
+  const __m256i thi = _mm256_broadcastsi128_si256 (
+    _mm_loadu_si128 ((const __m128i*)hi));
+  const __m256i mask = _mm256_set1_epi8 (0x0f);
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    const __m256i x = _mm256_loadu_si256 ((const __m256i*)(dst + i));
+    _mm256_storeu_si256 ((__m256i*)(dst + i), _mm256_xor_si256 (
+      _mm256_shuffle_epi8 (tlo, _mm256_and_si256 (x, mask)),
+      _mm256_shuffle_epi8 (thi,
+        _mm256_and_si256 (_mm256_srli_epi64 (x, 4), mask))));
+  }
+  MulSsse3 (dst + i, lo, hi, n - i);
+}
+#endif /* GF256_X86 */
+
+#ifdef GF256_NEON
+static void MulAddNeon (uint8_t *dst, const uint8_t *src,
+                        const uint8_t *lo, const uint8_t *hi, size_t n)
+{
+  const uint8x16_t tlo = vld1q_u8 (lo);
+  const uint8x16_t thi = vld1q_u8 (hi);
+  const uint8x16_t mask = vdupq_n_u8 (0x0f);
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    const uint8x16_t x = vld1q_u8 (src + i);
+    const uint8x16_t p = veorq_u8 (
+      vqtbl1q_u8 (tlo, vandq_u8 (x, mask)),
+      vqtbl1q_u8 (thi, vshrq_n_u8 (x, 4)));
+    vst1q_u8 (dst + i, veorq_u8 (vld1q_u8 (dst + i), p));
+  }
+  MulAddScalar (dst + i, src + i, lo, hi, n - i);
+}
+
+static void MulNeon (uint8_t *dst,
+                     const uint8_t *lo, const uint8_t *hi, size_t n)
+{
+  const uint8x16_t tlo = vld1q_u8 (lo);
+  const uint8x16_t thi = vld1q_u8 (hi);
+  const uint8x16_t mask = vdupq_n_u8 (0x0f);
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    const uint8x16_t x = vld1q_u8 (dst + i);
+    vst1q_u8 (dst + i, veorq_u8 (
+      vqtbl1q_u8 (tlo, vandq_u8 (x, mask)),
+      vqtbl1q_u8 (thi, vshrq_n_u8 (x, 4))));
+  }
+  MulScalar (dst + i, lo, hi, n - i);
+}
+#endif /* GF256_NEON */
+
+/** Log and exp tables, the nibble product tables, and the kernels */
+struct Gf256Tables {
+  uint8_t exp[512];
+  uint8_t log[256];
+
+  /** lo[c][i] = c * i, hi[c][i] = c * (i << 4) */
+  uint8_t lo[256][16];
+  uint8_t hi[256][16];
+
+  MulAddKernel mulAdd;
+  MulKernel mul;
+  const char* kernelName;
+
+  Gf256Tables ()
+  {
+    unsigned x = 1;
+    for (int i = 0; i < 255; ++i) {
+      exp[i] = exp[i + 255] = x;
+      log[x] = i;
+      x <<= 1;
+      if (x & 0x100)
+        x ^= GF256_POLY;
+    }
+    exp[510] = exp[511] = 0;
+    log[0] = 0;
+
+    for (int c = 0; c < 256; ++c) {
+      for (int i = 0; i < 16; ++i) {
+        lo[c][i] = Product (c, i);
+        hi[c][i] = Product (c, i << 4);
+      }
+    }
+
+    mulAdd = MulAddScalar;
+    mul = MulScalar;
+    kernelName = "scalar";
+#ifdef GF256_X86
+    __builtin_cpu_init ();
+    if (__builtin_cpu_supports ("avx2")) {
+      mulAdd = MulAddAvx2;
+      mul = MulAvx2;
+      kernelName = "avx2";
+    } else if (__builtin_cpu_supports ("ssse3")) {
+      mulAdd = MulAddSsse3;
+      mul = MulSsse3;
+      kernelName = "ssse3";
+    }
+#endif
+#ifdef GF256_NEON
+    mulAdd = MulAddNeon;
+    mul = MulNeon;
+    kernelName = "neon";
+#endif
+  }
+
+  uint8_t Product (uint8_t a, uint8_t b) const
+  {
+    if (a == 0 || b == 0)
+      return 0;
+    return exp[log[a] + log[b]];
+  }
+};
+
+static const Gf256Tables& Tables (void)
+{
+  static const Gf256Tables tables;
+  return tables;
+}
+
+uint8_t Gf256::Mul (uint8_t a, uint8_t b)
+{
+  return Tables ().Product (a, b);
+}
+
+uint8_t Gf256::Inv (uint8_t a)
+{
+  const Gf256Tables& t = Tables ();
+  return t.exp[255 - t.log[a]];
+}
+
+void Gf256::MulAddRegion (uint8_t *dst, const uint8_t *src, uint8_t c,
+                          size_t n)
+{
+  const Gf256Tables& t = Tables ();
+  if (c == 0)
+    return;
+  t.mulAdd (dst, src, t.lo[c], t.hi[c], n);
+}
+
+void Gf256::MulRegion (uint8_t *dst, uint8_t c, size_t n)
+{
+  const Gf256Tables& t = Tables ();
+  if (c == 1)
+    return;
+  if (c == 0) {
+    memset (dst, 0, n);
+    return;
+  }
+  t.mul (dst, t.lo[c], t.hi[c], n);
+}
+
+const char* Gf256::GetKernelName (void)
+{
+  return Tables ().kernelName;
+}
+
+} // namespace ns3
+
+// vim:set et:sts=2:sw=2
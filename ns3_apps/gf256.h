@@ -0,0 +1,41 @@
+#ifndef GF256_H
+#define GF256_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace ns3 {
+
+/**
+ * \brief Arithmetic in GF(256), for the fountain code
+ *
+ * The field is GF(2)[x] / (x^8 + x^4 + x^3 + x^2 + 1), as in RaptorQ.
+ * The region operations multiply with a constant by looking up the
+ * products of the low and high nibbles of every byte in two 16 entry
+ * tables, 16 or 32 bytes at a time with SSSE3, AVX2 or NEON table
+ * lookups where the CPU has them (checked at run time on x86).
+ */
+class Gf256
+{
+public:
+  static uint8_t Mul (uint8_t a, uint8_t b);
+
+  /** Multiplicative inverse of a, which must not be 0 */
+  static uint8_t Inv (uint8_t a);
+
+  /** dst[i] ^= c * src[i] for i < n */
+  static void MulAddRegion (uint8_t *dst, const uint8_t *src, uint8_t c,
+                            size_t n);
+
+  /** dst[i] = c * dst[i] for i < n */
+  static void MulRegion (uint8_t *dst, uint8_t c, size_t n);
+
+  /** Name of the region kernel in use:  avx2, ssse3, neon or scalar */
+  static const char* GetKernelName (void);
+};
+
+} // namespace ns3
+
+#endif /* GF256_H */
+
+// vim:set et:sts=2:sw=2
@@ -0,0 +1,209 @@
+#include <algorithm>
+#include <iterator>
+
+#include "ns3/assert.h"
+#include "ns3/log.h"
+#include "ns3/uinteger.h"
+
+#include "meshsim-calendar-scheduler.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("MeshSimCalendarScheduler");
+
+NS_OBJECT_ENSURE_REGISTERED (MeshSimCalendarScheduler);
+
+TypeId
+MeshSimCalendarScheduler::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::MeshSimCalendarScheduler")
+    .SetParent<Scheduler> ()
+    .SetGroupName ("Core")
+    .AddConstructor<MeshSimCalendarScheduler> ()
+    .AddAttribute ("BucketWidth",
+                   "Time covered by a bucket (default: 802.11 OFDM slot).",
+                   TimeValue (MicroSeconds (9)),
+                   MakeTimeAccessor (&MeshSimCalendarScheduler::m_bucketWidth),
+                   MakeTimeChecker (NanoSeconds (1)))
+    .AddAttribute ("Buckets",
+                   "Initial number of buckets (rounded up to a power of 2).",
+                   UintegerValue (4096),
+                   MakeUintegerAccessor (&MeshSimCalendarScheduler::m_initialBuckets),
+                   MakeUintegerChecker<uint32_t> (1))
+  ;
+  return tid;
+}
+
+MeshSimCalendarScheduler::MeshSimCalendarScheduler ()
+  : m_initialBuckets (4096),
+    m_mask (0),
+    m_width (1),
+    m_size (0),
+    m_lastTs (0),
+    m_next (0),
+    m_nextValid (false)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+MeshSimCalendarScheduler::~MeshSimCalendarScheduler ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+MeshSimCalendarScheduler::Init (void)
+{
+  m_width = std::max<int64_t> (1, m_bucketWidth.GetTimeStep ());
+  uint32_t n = 1;
+  while (n < m_initialBuckets)
+    n <<= 1;
+  m_buckets.resize (n);
+  m_mask = n - 1;
+}
+
+uint32_t
+MeshSimCalendarScheduler::BucketOf (uint64_t ts) const
+{
+  return (ts / m_width) & m_mask;
+}
+
+void
+MeshSimCalendarScheduler::DoInsert (const Event &ev)
+{
+  // Most events go at the end of their bucket, so search from there
+  Bucket &bucket = m_buckets[BucketOf (ev.key.m_ts)];
+  Bucket::iterator it = bucket.end ();
+  while (it != bucket.begin ())
+    {
+      Bucket::iterator prev = std::prev (it);
+      if (!(ev.key < prev->key))
+        break;
+      it = prev;
+    }
+  bucket.insert (it, ev);
+}
+
+void
+MeshSimCalendarScheduler::Resize (uint32_t n)
+{
+  NS_LOG_FUNCTION (this << n);
+  std::vector<Bucket> old (n);
+  old.swap (m_buckets);
+  m_mask = n - 1;
+  for (Bucket &bucket : old)
+    for (const Event &ev : bucket)
+      DoInsert (ev);
+  m_nextValid = false;
+}
+
+void
+MeshSimCalendarScheduler::Insert (const Event &ev)
+{
+  NS_LOG_FUNCTION (this << ev.impl << ev.key.m_ts << ev.key.m_uid);
+  if (m_buckets.empty ())
+    Init ();
+
+  // Keep the cached next bucket valid; it held the earliest event
+  if (m_nextValid && ev.key < m_buckets[m_next].front ().key)
+    m_next = BucketOf (ev.key.m_ts);
+  DoInsert (ev);
+  ++m_size;
+
+  if (m_size > 2 * m_buckets.size ())
+    Resize (2 * m_buckets.size ());
+}
+
+bool
+MeshSimCalendarScheduler::IsEmpty (void) const
+{
+  return m_size == 0;
+}
+
+uint32_t
+MeshSimCalendarScheduler::FindNext (void) const
+{
+  if (m_nextValid)
+    return m_next;
+
+  // Look through one year, starting at the bucket of the last event
+  const uint64_t slot = m_lastTs / m_width;
+  const uint32_t n = m_buckets.size ();
+  for (uint32_t i = 0; i < n; ++i)
+    {
+      const uint32_t b = (slot + i) & m_mask;
+      const Bucket &bucket = m_buckets[b];
+      if (!bucket.empty () && bucket.front ().key.m_ts / m_width <= slot + i)
+        {
+          m_next = b;
+          m_nextValid = true;
+          return b;
+        }
+    }
+
+  // Nothing within a year:  Find the earliest event directly
+  bool found = false;
+  for (uint32_t b = 0; b < n; ++b)
+    {
+      const Bucket &bucket = m_buckets[b];
+      if (bucket.empty ())
+        continue;
+      if (!found || bucket.front ().key < m_buckets[m_next].front ().key)
+        {
+          m_next = b;
+          found = true;
+        }
+    }
+  NS_ASSERT (found);
+  m_nextValid = true;
+  return m_next;
+}
+
+Scheduler::Event
+MeshSimCalendarScheduler::PeekNext (void) const
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (!IsEmpty ());
+  return m_buckets[FindNext ()].front ();
+}
+
+Scheduler::Event
+MeshSimCalendarScheduler::RemoveNext (void)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (!IsEmpty ());
+  Bucket &bucket = m_buckets[FindNext ()];
+  Event ev = bucket.front ();
+  bucket.pop_front ();
+  --m_size;
+  m_lastTs = ev.key.m_ts;
+
+  // The next event is likely in the same bucket; if not, the search
+  // starts there anyway.
+  m_nextValid = false;
+  return ev;
+}
+
+void
+MeshSimCalendarScheduler::Remove (const Event &ev)
+{
+  NS_LOG_FUNCTION (this << ev.impl << ev.key.m_ts << ev.key.m_uid);
+  NS_ASSERT (!IsEmpty ());
+  Bucket &bucket = m_buckets[BucketOf (ev.key.m_ts)];
+  for (Bucket::iterator it = bucket.begin (); it != bucket.end (); ++it)
+    {
+      if (it->key.m_uid == ev.key.m_uid)
+        {
+          NS_ASSERT (ev.impl == it->impl);
+          bucket.erase (it);
+          --m_size;
+          m_nextValid = false;
+          return;
+        }
+    }
+  NS_ASSERT_MSG (false, "Event not found");
+}
+
+} // namespace ns3
+
+// vim:sw=2:sts=2:et
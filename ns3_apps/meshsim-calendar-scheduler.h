@@ -0,0 +1,84 @@
+#ifndef MESHSIM_CALENDAR_SCHEDULER_H
+#define MESHSIM_CALENDAR_SCHEDULER_H
+
+#include <list>
+#include <vector>
+
+#include "ns3/nstime.h"
+#include "ns3/scheduler.h"
+
+namespace ns3 {
+
+/**
+ * \brief Calendar queue event scheduler tuned to wifi timing
+ *
+ * Unlike ns3::CalendarScheduler, the bucket width is fixed (by default
+ * one 802.11 OFDM slot, 9 us) rather than estimated from the queue
+ * contents.  Wifi simulations have most of their events a few slots
+ * ahead of now, many of them at the same time stamp, which makes the
+ * estimate of CalendarScheduler swing and resize often.  With a
+ * fixed width, the near events spread over a few adjacent buckets;
+ * events with equal time stamps are mostly inserted in order, so
+ * insertion at the tail of a bucket is cheap.  The number of buckets
+ * doubles when the queue holds more than two events per bucket, and
+ * events beyond one "year" (Buckets * BucketWidth) are found by a
+ * direct search when nothing is left closer to now.
+ */
+class MeshSimCalendarScheduler : public Scheduler
+{
+public:
+  static TypeId GetTypeId (void);
+
+  MeshSimCalendarScheduler ();
+  virtual ~MeshSimCalendarScheduler ();
+
+  virtual void Insert (const Event &ev);
+  virtual bool IsEmpty (void) const;
+  virtual Event PeekNext (void) const;
+  virtual Event RemoveNext (void);
+  virtual void Remove (const Event &ev);
+
+private:
+  typedef std::list<Event> Bucket;
+
+  // Set up the buckets from the attributes.
+  void Init (void);
+
+  // Index of the bucket for time stamp ts.
+  uint32_t BucketOf (uint64_t ts) const;
+
+  // Insert ev into its bucket, keeping the bucket sorted.
+  void DoInsert (const Event &ev);
+
+  // Rehash into n buckets.
+  void Resize (uint32_t n);
+
+  // Find the bucket holding the next event (m_size > 0).
+  uint32_t FindNext (void) const;
+
+  // Attributes
+  Time m_bucketWidth;
+  uint32_t m_initialBuckets;
+
+  std::vector<Bucket> m_buckets;
+  uint32_t m_mask;
+
+  // Bucket width, in time steps
+  uint64_t m_width;
+
+  // Number of events queued
+  uint32_t m_size;
+
+  // Time stamp of the last event removed; no event is earlier.
+  uint64_t m_lastTs;
+
+  // Cache of FindNext(), valid if m_nextValid
+  mutable uint32_t m_next;
+  mutable bool m_nextValid;
+};
+
+} // namespace ns3
+
+#endif /* MESHSIM_CALENDAR_SCHEDULER_H */
+
+// vim:sw=2:sts=2:et
@@ -91,6 +91,12 @@ MeshSimOnOffApplication::GetTypeId (void)
                    MakeTypeIdAccessor (&MeshSimOnOffApplication::m_tid),
                    // This should check for SocketFactory as a parent
                    MakeTypeIdChecker ())
+    .AddAttribute ("CompactHeader",
+                   "Whether to use the compact (varint) RQ header encoding "
+                   "on UDP",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&MeshSimOnOffApplication::m_compactHeader),
+                   MakeBooleanChecker ())
     .AddTraceSource ("Tx", "A new packet is created and is sent",
                      MakeTraceSourceAccessor (&MeshSimOnOffApplication::m_txTrace),
                      "ns3::Packet::TracedCallback")
@@ -108,7 +114,8 @@ MeshSimOnOffApplication::MeshSimOnOffApplication ()
     m_residualBits (0),
     m_lastStartTime (Seconds (0)),
     m_totBytes (0),
-    m_seqNumber (0)
+    m_seqNumber (0),
+    m_compactHeader (false)
 {
   NS_LOG_FUNCTION (this);
 }
@@ -293,6 +300,7 @@ void MeshSimOnOffApplication::SendPacket ()
     {
       RqHeader hdr(m_seqNumber);
       ++m_seqNumber;
+      hdr.SetCompact(m_compactHeader);
       packet->AddHeader(hdr);
     }
 
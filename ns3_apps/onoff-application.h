@@ -164,6 +164,7 @@ private:
   EventId         m_sendEvent;    //!< Event id of pending "send packet" event
   TypeId          m_tid;          //!< Type of the socket used
   uint64_t        m_seqNumber;    //!< Sequence number of next packet
+  bool            m_compactHeader; //!< Use the compact RQ header encoding
 
   /// Traced Callback: transmitted packets.
   TracedCallback<Ptr<const Packet> > m_txTrace;
@@ -113,6 +113,25 @@ uint64_t ProxyBase::GetTotalTx () const
   return tot;
 }
 
+void ProxyBase::GetSockets (std::vector< Ptr<Socket> > *sockets) const
+{
+  NS_LOG_FUNCTION (this);
+  for (int i = 0; i < RX_SLOT_COUNT; ++i) {
+    for (const auto& sock: m_rxSlots[i].accepted_socks)
+      sockets->push_back (sock);
+  }
+  for (int i = 0; i < TX_SLOT_COUNT; ++i) {
+    if (m_txSlots[i].sock)
+      sockets->push_back (m_txSlots[i].sock);
+  }
+}
+
+void ProxyBase::GetStoreSize (uint32_t *packets, uint64_t *bytes) const
+{
+  *packets = 0;
+  *bytes = 0;
+}
+
 void ProxyBase::SetTidDefaultProtocols(TypeId* tid,
 				const TypeId& rx,
 				const TypeId& tx)
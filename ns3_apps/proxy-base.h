@@ -21,6 +21,9 @@
 #ifndef PROXY_BASE_H
 #define PROXY_BASE_H
 
+#include <list>
+#include <vector>
+
 #include "ns3/application.h"
 #include "ns3/event-id.h"
 #include "ns3/ptr.h"
@@ -63,6 +66,19 @@ public:
    */
   uint64_t GetTotalTx () const;
 
+  /**
+   * \brief Get the connected sockets (to look at their buffers)
+   * \param sockets the sockets are appended to this
+   */
+  void GetSockets (std::vector< Ptr<Socket> > *sockets) const;
+
+  /**
+   * \brief Get the amount of data held by the proxy itself
+   * \param packets number of packets held
+   * \param bytes number of bytes held
+   */
+  virtual void GetStoreSize (uint32_t *packets, uint64_t *bytes) const;
+
   enum {
     RX_SLOT_COUNT = 8,
     TX_SLOT_COUNT = 8
@@ -143,7 +159,12 @@ protected:
    */
   virtual void HandleSend(int slotID, Ptr<Socket>, uint32_t sz);
 
-  void HandleBackRead (Ptr<Socket> socket);
+  /**
+   * \brief Handle data received back on a TX socket (from the peer
+   * the proxy sends to); discarded by default
+   * \param socket the TX socket
+   */
+  virtual void HandleBackRead (Ptr<Socket> socket);
 
   // Receive state
 
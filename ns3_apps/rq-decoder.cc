@@ -20,6 +20,7 @@
 #include "ns3/uinteger.h"
 #include "ns3/double.h"
 
+#include "rq-feedback-header.h"
 #include "rq-header.h"
 #include "rq-decoder.h"
 
@@ -29,6 +30,9 @@ NS_LOG_COMPONENT_DEFINE ("RqDecoder");
 
 NS_OBJECT_ENSURE_REGISTERED (RqDecoder);
 
+/* Stream of a source symbol not received (yet) */
+static const int ESI_MISSING = -2;
+
 TypeId
 RqDecoder::GetTypeId (void)
 {
@@ -51,9 +55,45 @@ RqDecoder::GetTypeId (void)
                      UintegerValue (120),
                      MakeUintegerAccessor (&RqDecoder::m_rqnval),
                      MakeUintegerChecker<uint32_t> (1))
+      .AddAttribute ("RealCode",
+                     "Whether to tell decoding success by decoding the "
+                     "received symbol IDs of a GF(256) fountain code, "
+                     "rather than by counting K symbols",
+                     BooleanValue (false),
+                     MakeBooleanAccessor (&RqDecoder::m_useRealCode),
+                     MakeBooleanChecker ())
+      .AddAttribute ("DecodeCpu",
+                     "Whether to hold decoded data back until the "
+                     "DecoderCpu of the node has decoded the block",
+                     BooleanValue (false),
+                     MakeBooleanAccessor (&RqDecoder::m_useCpu),
+                     MakeBooleanChecker ())
+      .AddAttribute ("Feedback",
+                     "Whether to report decoded and abandoned source "
+                     "blocks back to the encoder",
+                     BooleanValue (false),
+                     MakeBooleanAccessor (&RqDecoder::m_useFeedback),
+                     MakeBooleanChecker ())
+      .AddAttribute ("BlockWindow",
+                     "The number of source blocks open at a time, i.e., "
+                     "by how many blocks symbols may be reordered and "
+                     "still count",
+                     UintegerValue (1),
+                     MakeUintegerAccessor (&RqDecoder::m_window),
+                     MakeUintegerChecker<uint32_t> (1))
+      .AddAttribute ("InterleaveDepth",
+                     "The number of source blocks the encoder interleaves; "
+                     "the window then holds BlockWindow groups of them",
+                     UintegerValue (1),
+                     MakeUintegerAccessor (&RqDecoder::m_depth),
+                     MakeUintegerChecker<uint32_t> (1))
       .AddTraceSource ("RqDecodingEvent", "An Rq Decoding event occurred",
                      MakeTraceSourceAccessor(&RqDecoder::m_rqDecodingTrace),
                      "ns3::RqDecoder::RqDecoderCallback")
+      .AddTraceSource ("DecodeDelay",
+                     "A block was decoded by the DecoderCpu",
+                     MakeTraceSourceAccessor(&RqDecoder::m_decodeDelayTrace),
+                     "ns3::RqDecoder::DecodeDelayCallback")
     ;
     ProxyBase::SetTidDefaultProtocols(&tid,
                      UdpSocketFactory::GetTypeId(),
@@ -67,11 +107,16 @@ RqDecoder::RqDecoder ()
   : m_rqkval(100),
     m_rqnval(120),
     m_rqtval(1024),
+    m_useRealCode(false),
+    m_useCpu(false),
+    m_useFeedback(false),
+    m_window(1),
+    m_depth(1),
     m_sbid(-1),
-    m_sb_nrcv(0),
-    m_sb_nsrcrcv(0),
     m_nslots(0), // Need to figure this out when app is started.
-    m_slotStates{0}
+    m_nbuffered{0},
+    m_relSbid{0},
+    m_relPos{0}
 {
   NS_LOG_FUNCTION (this);
 }
@@ -91,19 +136,240 @@ void RqDecoder::StartApplication (void)
     if (m_txSlots[m_nslots].addr.IsInvalid())
       break;
   }
+
+  // The ring of open blocks.  Only the ESIs matter, so the decoders
+  // keep no symbol data.
+  m_blocks.clear ();
+  m_blocks.resize (m_window * m_depth);
+  for (int i = 0; i < m_nslots; ++i) {
+    m_relSbid[i] = 0;
+    m_relPos[i] = 0;
+  }
+  for (BlockState& b: m_blocks) {
+    b.sbid = -1;
+    b.esistream.resize (m_rqkval);
+    b.esicounts.resize (m_rqkval * m_nslots);
+    if (m_useRealCode)
+      b.code.reset (new FountainDecoder (m_rqkval, 0));
+  }
+
+  if (m_useCpu)
+    m_cpu = DecoderCpu::GetOrCreate (GetNode ());
+}
+
+void RqDecoder::StopApplication (void)
+{
+  // Blocks still on the CPU are never released
+  m_decodeJobs.clear ();
+  m_feedbackSocket = NULL;
+  ProxyBase::StopApplication();
+}
+
+RqDecoder::BlockState* RqDecoder::GetBlock (int sbid)
+{
+  if (sbid < 0)
+    return NULL;
+  BlockState* b = &m_blocks[sbid % m_blocks.size ()];
+  return b->sbid == sbid ? b : NULL;
+}
+
+void RqDecoder::InitBlock (int sbid)
+{
+  BlockState* b = &m_blocks[sbid % m_blocks.size ()];
+  b->sbid = sbid;
+  b->kval = m_rqkval;
+  b->haslast = false;
+  b->laststream = -1;
+  b->lastlen = 0;
+  b->nrcv = 0;
+  b->nsrcrcv = 0;
+  b->maxesi = -1;
+  b->decoded = false;
+  b->released = false;
+  if (b->code)
+    b->code->Reset ();
+  for (int i = 0; i < m_nslots; ++i) {
+    b->slots[i].m_nsymbcontig = 0;
+    b->slots[i].m_nsymb = 0;
+  }
+  std::fill (b->esistream.begin (), b->esistream.end (), ESI_MISSING);
 }
 
-void RqDecoder::PopulateDecodeInfo(DecodeInfo* I)
+void RqDecoder::CloseBlock (BlockState* b)
 {
-  I->sbid = m_sbid;
-  I->success = (m_sb_nrcv >= m_rqkval);
-  I->n_rcv = m_sb_nrcv;
-  I->n_src_rcv = m_sb_nsrcrcv;
+  /* Write DecodeInfo trace
+   *
+   * If we were successful in decoding, a trace call was
+   * already issued for the same SB previously.  We
+   * send another success message here, because only now we
+   * know now how many symbols total were received for
+   * this source block. (On the other hand, the trace call
+   * here will be missing for the blocks still open at the end.)
+   * Blocks of which nothing was received are not traced.
+   */
+  if (b->nrcv > 0) {
+    DecodeInfo I;
+    PopulateDecodeInfo(*b, true, &I);
+    m_rqDecodingTrace(I);
+
+    /* Tell the encoder about the loss of a block that
+     * could not be decoded
+     */
+    if (m_useFeedback && !b->decoded)
+      SendFeedback (*b);
+  }
+
+  b->sbid = -1;
+}
+
+void RqDecoder::CloseGroup (int sbid)
+{
+  /* All older groups are closed, so what the group holds can go */
   for (int i = 0; i < m_nslots; ++i) {
-    I->slotinfo[i].n_src_rcv = m_slotStates[i].m_nsymb;
-    I->slotinfo[i].n_contig_src_rcv = m_slotStates[i].m_nsymbcontig;
+    if (m_relSbid[i] > sbid)
+      continue;
+    if (m_relSbid[i] < sbid) {
+      m_relSbid[i] = sbid;
+      m_relPos[i] = 0;
+    }
+    ReleaseStream (i, true);
+  }
+  for (int s = sbid; s < sbid + (int)m_depth; ++s) {
+    if (BlockState* b = GetBlock (s))
+      CloseBlock (b);
+  }
+}
+
+void RqDecoder::OpenBlocks (int sbid)
+{
+  const int window = m_blocks.size ();
+  const int depth = m_depth;
+  const int newest = (sbid / depth + 1) * depth - 1;
+
+  /* Give up the groups that leave the window, oldest first */
+  for (int old = std::max (0, m_sbid - window + 1);
+       old <= std::min (m_sbid, newest - window); old += depth)
+    CloseGroup (old);
+
+  /* Open the new ones */
+  for (int s = std::max (m_sbid + 1, newest - window + 1); s <= newest; ++s)
+    InitBlock (s);
+  m_sbid = newest;
+
+  /* Streams may now get past the groups given up */
+  ReleaseHeld ();
+}
+
+int RqDecoder::HoldsStream (const BlockState& b, int esi, int slotID) const
+{
+  if (esi >= b.kval)
+    return 0;
+  if (b.esistream[esi] != ESI_MISSING)
+    return b.esistream[esi] == slotID;
+  if (b.haslast && esi == b.kval - 1)
+    return b.laststream == slotID;
+
+  /* The symbols received around it bound the run of missing ones, and
+   * so does the last source symbol once it is known.  The counts after
+   * the run are final once an ESI >= K - 1 was received.
+   */
+  const int end = b.haslast ? b.kval - 1 : b.kval;
+  int lo = esi - 1;
+  while (lo >= 0 && b.esistream[lo] == ESI_MISSING)
+    --lo;
+  int hi = esi + 1;
+  while (hi < end && b.esistream[hi] == ESI_MISSING)
+    ++hi;
+  if (hi == b.kval && b.maxesi < b.kval - 1)
+    return -1;
+
+  /* # symbols of each stream in the run */
+  int nrun[TX_SLOT_COUNT];
+  for (int i = 0; i < m_nslots; ++i) {
+    if (hi < end)
+      nrun[i] = b.esicounts[hi * m_nslots + i] - (b.esistream[hi] == i);
+    else
+      nrun[i] = b.slots[i].m_nsymb - (hi < b.kval && b.laststream == i);
+    if (lo >= 0)
+      nrun[i] -= b.esicounts[lo * m_nslots + i];
+  }
+  if (nrun[slotID] == 0)
+    return 0;
+  if (nrun[slotID] == hi - lo - 1)
+    return 1;
+  if (!b.decoded)
+    return -1;
+
+  /* Decoded:  the data of the run is known, say in stream order */
+  int first = lo + 1;
+  for (int i = 0; i < slotID; ++i)
+    first += nrun[i];
+  return esi >= first && esi < first + nrun[slotID];
+}
+
+void RqDecoder::ReleaseStream (int slotID, bool giveUp)
+{
+  const int depth = m_depth;
+  std::vector<bool> lost (depth, false);
+  for (;; ++m_relPos[slotID]) {
+    if (m_relPos[slotID] == m_rqkval * depth) {
+      m_relSbid[slotID] += depth;
+      m_relPos[slotID] = 0;
+      if (giveUp)
+        return;
+    }
+    const int esi = m_relPos[slotID] / depth;
+    const int lane = m_relPos[slotID] % depth;
+    const int sbid = m_relSbid[slotID] + lane;
+    if (sbid > m_sbid)
+      return;
+
+    /* Symbols of blocks given up earlier are lost */
+    BlockState* b = GetBlock (sbid);
+    if (b == NULL || lost[lane])
+      continue;
+    const int holds = HoldsStream (*b, esi, slotID);
+    if (holds == 0)
+      continue;
+
+    const uint32_t len = b->haslast && esi == b->kval - 1
+      ? b->lastlen : m_rqtval;
+    if (holds == 1 && (b->esistream[esi] == slotID || b->released)) {
+      m_nbuffered[slotID] += len;
+    } else if (holds == 1 && giveUp && b->decoded) {
+      /* Out once the CPU is done with the block */
+      for (DecodeJob& job: m_decodeJobs) {
+        if (job.sbid == (uint32_t)sbid)
+          job.release[slotID] += len;
+      }
+    } else if (giveUp) {
+      /* The rest of the stream in the block is lost with it */
+      lost[lane] = true;
+    } else {
+      return;
+    }
+  }
+}
+
+void RqDecoder::ReleaseHeld (void)
+{
+  for (int i = 0; i < m_nslots; ++i)
+    ReleaseStream (i, false);
+}
+
+void RqDecoder::PopulateDecodeInfo(const BlockState& b, bool final,
+                                   DecodeInfo* I)
+{
+  I->sbid = b.sbid;
+  I->success = b.code ? b.code->IsDecodable () : (b.nrcv >= b.kval);
+  I->n_rcv = b.nrcv;
+  I->n_src_rcv = b.nsrcrcv;
+  for (int i = 0; i < m_nslots; ++i) {
+    I->slotinfo[i].n_src_rcv = b.slots[i].m_nsymb;
+    I->slotinfo[i].n_contig_src_rcv = b.slots[i].m_nsymbcontig;
   }
   I->n_slots = m_nslots;
+  I->final = final;
 }
 
 void RqDecoder::HandleRead (int slotID, Ptr<Socket> socket)
@@ -126,47 +392,49 @@ void RqDecoder::HandleRead (int slotID, Ptr<Socket> socket)
       socket->GetSockName (localAddress);
       m_rxTrace (packet, from);
       m_rxTraceWithAddresses (packet, from, localAddress);
+      m_feedbackSocket = socket;
+      m_feedbackAddr = from;
 
       /* Decoding logic */
       const int pkt_id = (int)rq_hdr.GetSeqno();
       NS_LOG_INFO("Got packet with sequence number " << pkt_id);
 
-      const int sbid = pkt_id / m_rqnval;
-      const int esi = pkt_id % m_rqnval;
-
-      /* Move to subsequent source block? */
-      if (sbid > m_sbid) {
-          /* Write DecodeInfo trace
-           *
-           * If we were successful in decoding, a trace call was
-           * already issued for the same SB previously.  We
-           * send another success message here, because only now we
-           * know now how many symbols total were received for
-           * this source block. (On the other hand, the trace call
-           * here will be missing for the last source block.)
-           */
-          if (m_sbid >= 0)
-            {
-              DecodeInfo I;
-              PopulateDecodeInfo(&I);
-              m_rqDecodingTrace(I);
-            }
-
-          /* Update RQ source block id */
-          m_sbid = sbid;
-          m_sb_nrcv = 0;
-          m_sb_nsrcrcv = 0;
-          for (int i = 0; i < m_nslots; ++i) {
-            m_slotStates[i].m_nsymbcontig = 0;
-            m_slotStates[i].m_nsymb = 0;
-          }
-      } else if (sbid < m_sbid) {
+      /* Sequence numbers follow the send order of a group of
+       * InterleaveDepth blocks
+       */
+      const int group_size = m_depth * m_rqnval;
+      const int sbid = pkt_id / group_size * m_depth
+        + pkt_id % group_size % m_depth;
+      const int esi = pkt_id % group_size / m_depth;
+
+      /* Move the window to a subsequent source block? */
+      if (sbid > m_sbid)
+        OpenBlocks (sbid);
+      BlockState* b = GetBlock (sbid);
+      if (b == NULL) {
           /* Packet is for already processed sb */
           NS_LOG_INFO ("Got packet for already processed source "
             "block.");
           continue;
       }
 
+      /* A shortened block:  its source symbols from the block K on
+       * are padding, which the decoder knows
+       */
+      const int kval = rq_hdr.GetBlockK ();
+      if (kval > 0 && kval < b->kval) {
+        if (b->code) {
+          for (int e = kval; e < b->kval; ++e)
+            b->code->AddSymbol (e, NULL);
+        }
+        b->kval = kval;
+      }
+      if (kval > 0) {
+        b->haslast = true;
+        b->laststream = rq_hdr.GetLastStreamID ();
+        b->lastlen = rq_hdr.GetLastLength ();
+      }
+
       /* Update all the slot states' nsymb counters
        *
        * Once we have >= k packets for the SB, we'll know exactly
@@ -176,50 +444,68 @@ void RqDecoder::HandleRead (int slotID, Ptr<Socket> socket)
        * iseq values for the source block.  The same guarantee
        * can't be made for < k packets.
        */
-      const std::vector<int>& iseq = rq_hdr.GetIseqData();
-      NS_ASSERT(m_nslots == (int)iseq.size());
+      const int* iseq = rq_hdr.GetIseqData();
+      NS_ASSERT(m_nslots == rq_hdr.GetIseqCount());
       for (int i = 0; i < m_nslots; ++i) {
-        if (iseq[i] > m_slotStates[i].m_nsymb)
-          m_slotStates[i].m_nsymb = iseq[i];
+        if (iseq[i] > b->slots[i].m_nsymb)
+          b->slots[i].m_nsymb = iseq[i];
       }
 
       /* Update slot state for the stream of the packet */
       const int streamid = rq_hdr.GetIseqStreamID ();
       if (streamid != -1
-        && m_slotStates[streamid].m_nsymbcontig + 1
-           == m_slotStates[streamid].m_nsymb)
+        && b->slots[streamid].m_nsymbcontig + 1
+           == b->slots[streamid].m_nsymb)
       {
-        /* Conceptually, when data is received in order for the
-         * stream, just send it out on the corresponding socket
-         * immediately.  We can't do that if the data is not
-         * contiguous.
-         */
-        ++m_slotStates[streamid].m_nsymbcontig;
-        m_slotStates[streamid].m_nbuffered += m_rqtval;
+        ++b->slots[streamid].m_nsymbcontig;
+      }
+
+      /* Conceptually, the data of a source symbol goes out on the
+       * socket of its stream once the older data of the stream did
+       */
+      if (esi < b->kval && b->esistream[esi] == ESI_MISSING) {
+        b->esistream[esi] = streamid;
+        std::copy (iseq, iseq + m_nslots,
+                   b->esicounts.begin () + esi * m_nslots);
       }
 
       /* Update code level counters */
-      ++m_sb_nrcv;
-      if (esi < m_rqkval) {
-          ++m_sb_nsrcrcv;
+      ++b->nrcv;
+      if (esi < b->kval) {
+          ++b->nsrcrcv;
       }
+      b->maxesi = std::max(b->maxesi, esi);
 
       /* Check if we have enough to decode now */
-      if (m_sb_nrcv == m_rqkval) {
+      if (b->code)
+        b->code->AddSymbol (esi, NULL);
+      if (!b->decoded
+          && (b->code ? b->code->IsDecodable () : b->nrcv >= b->kval))
+      {
+          b->decoded = true;
+
           /* Conceptually, decode and send what we held back
-           * on each stream
+           * on each stream, once the CPU is done if there is one
            */
-          for (int i = 0; i < m_nslots; ++i) {
-            SlotState* st = &m_slotStates[i];
-            st->m_nbuffered
-              += (st->m_nsymb - st->m_nsymbcontig) * m_rqtval;
+          if (m_cpu) {
+            DecodeJob job = { (uint32_t)b->sbid, { 0 } };
+            m_decodeJobs.push_back (job);
+            m_cpu->Submit (b->kval, b->sbid,
+                           MakeCallback (&RqDecoder::DecodeDone, this));
+          } else {
+            b->released = true;
           }
 
           /* Write DecodeInfo trace */
           DecodeInfo I;
-          PopulateDecodeInfo(&I);
+          PopulateDecodeInfo(*b, false, &I);
           m_rqDecodingTrace(I);
+
+          /* Let the encoder stop sending repair symbols */
+          if (m_useFeedback)
+            SendFeedback (*b);
       }
+      ReleaseHeld ();
     }
 
   /* Try to send out some while we're at it */
@@ -227,15 +513,58 @@ void RqDecoder::HandleRead (int slotID, Ptr<Socket> socket)
     TryToSend(i);
 }
 
+void RqDecoder::SendFeedback (const BlockState& b)
+{
+  if (!m_feedbackSocket)
+    return;
+  /* The ESIs between the K of a shortened block and Kval were not sent */
+  int nsent = b.maxesi + 1;
+  if (b.maxesi >= m_rqkval)
+    nsent -= m_rqkval - b.kval;
+  RqFeedbackHeader hdr(b.sbid, b.decoded, b.nrcv, nsent);
+  Ptr<Packet> pkt = Create<Packet> ();
+  pkt->AddHeader (hdr);
+  m_feedbackSocket->SendTo (pkt, 0, m_feedbackAddr);
+}
+
+void RqDecoder::DecodeDone (uint32_t sbid, Time queueing, Time decoding)
+{
+  /* With several cores, blocks of different K can finish out of order,
+   * so look the job up.  It's gone if the application was stopped
+   * meanwhile.
+   */
+  std::list<DecodeJob>::iterator it = m_decodeJobs.begin ();
+  while (it != m_decodeJobs.end () && it->sbid != sbid)
+    ++it;
+  if (it == m_decodeJobs.end ())
+    return;
+  const DecodeJob job = *it;
+  m_decodeJobs.erase (it);
+
+  /* If the block was given up meanwhile, its data goes out right away */
+  BlockState* b = GetBlock (job.sbid);
+  if (b != NULL) {
+    b->released = true;
+    ReleaseHeld ();
+  } else {
+    for (int i = 0; i < m_nslots; ++i)
+      m_nbuffered[i] += job.release[i];
+  }
+  m_decodeDelayTrace (job.sbid, queueing, decoding);
+
+  for (int i = 0; i < m_nslots; ++i)
+    TryToSend(i);
+}
+
 void RqDecoder::TryToSend(int slotID)
 {
   TxSlot* sl = &m_txSlots[slotID];
-  SlotState* ss = &m_slotStates[slotID];
+  uint32_t* nbuffered = &m_nbuffered[slotID];
 
   /* Check if anything can be sent */
   if (!sl->connected)
     return;
-  if (ss->m_nbuffered == 0)
+  if (*nbuffered == 0)
     return;
 
   const uint32_t txavail = sl->sock->GetTxAvailable();
@@ -243,13 +572,13 @@ void RqDecoder::TryToSend(int slotID)
     return;
 
   /* Send */
-  const uint32_t amount = std::min(txavail, ss->m_nbuffered);
+  const uint32_t amount = std::min(txavail, *nbuffered);
   Ptr<Packet> pkt = Create<Packet> (amount);
   const uint32_t sent = sl->sock->Send (pkt);
   NS_ASSERT(sent == amount);
 
   /* Update accounting */
-  ss->m_nbuffered -= sent;
+  *nbuffered -= sent;
   sl->total += sent;
   m_txTrace(pkt);
   // XXX figure out addresses m_txTraceWithAddresses(pkt, a1, a2);
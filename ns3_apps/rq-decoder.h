@@ -26,7 +26,14 @@
 #include "ns3/ptr.h"
 #include "ns3/traced-callback.h"
 #include "ns3/address.h"
+#include "ns3/nstime.h"
 
+#include <list>
+#include <memory>
+#include <vector>
+
+#include "decoder-cpu.h"
+#include "fountain-code.h"
 #include "proxy-base.h"
 
 namespace ns3 {
@@ -42,6 +49,43 @@ namespace ns3 {
  * \brief This application simulates an RQ decoder.  It receives
  * encoded UDP packet, conceptually decodes source blocks and transmits
  * the results as TCP stream.
+ *
+ * By default, a source block counts as decoded once K symbols of it
+ * were received.  With the RealCode attribute, the decoder instead
+ * runs the elimination of a FountainCode over the received ESIs, so
+ * that blocks can fail to decode with K or more symbols, as they do
+ * with RaptorQ.
+ *
+ * With the DecodeCpu attribute, the data held back for a decoded
+ * block is only released once the DecoderCpu of the node, which all
+ * decoders of the node share, has finished decoding the block.
+ *
+ * With the Feedback attribute, the decoder sends an RqFeedbackHeader
+ * back to the encoder (on the socket and to the address the symbols
+ * came from) when a block becomes decodable, and when it gives up on
+ * a block it could not decode.
+ *
+ * The decoder keeps the BlockWindow most recent source blocks open, so
+ * that symbols reordered by up to that many blocks still count.  A
+ * block is given up once a symbol of a block BlockWindow blocks newer
+ * arrives; symbols of blocks given up are dropped.  With a BlockWindow
+ * of 1 (the default), a block is given up as soon as a symbol of a
+ * newer block arrives.  With an InterleaveDepth D, the encoder sends D
+ * blocks at a time, and the window holds BlockWindow such groups of D
+ * blocks, which are opened and given up together.
+ *
+ * The data of each stream is released in the order the encoder sent
+ * it, ESI by ESI and block by block within a group:  a symbol goes out
+ * once all older symbols of its stream were received, decoded or lost
+ * with a block given up.  The stream of a missing symbol follows from
+ * the iseq counts of the symbols around it, or from the decoded block.
+ * When a block is given up, the data of its streams after their first
+ * missing symbol in it is lost.
+ *
+ * A block the encoder closed early has fewer source symbols, as its
+ * RqHeaders say; the missing ones count as received zero padding.  Its
+ * last source symbol may hold less than Tval bytes of data, and only
+ * these are released.
  */
 class RqDecoder : public ProxyBase
 {
@@ -69,14 +113,95 @@ public:
     } slotinfo[TX_SLOT_COUNT];
 
     int n_slots;	//!< # of slots.
+    bool final;         //!< The block was given up, so this is the last
+                        //!< DecodeInfo for it
   };
 
   typedef void (*RqDecoderCallback)(const DecodeInfo& I);
 
+  /**
+   * \brief Called when the DecoderCpu finished decoding a block
+   * \param sbid the source block ID
+   * \param queueing the time the block waited for a core
+   * \param decoding the time the core took to decode the block
+   */
+  typedef void (*DecodeDelayCallback)(uint32_t sbid, Time queueing,
+                                      Time decoding);
+
 protected:
   virtual void StartApplication (void);
+  virtual void StopApplication (void);
 
-  void PopulateDecodeInfo(DecodeInfo* I);
+  /// Per stream state of a source block
+  struct SlotState {
+    int           m_nsymbcontig;   //!< # contiguous symbs for stream rcvd
+    int		  m_nsymb;         //!< # symbs for that stream in SB
+  };
+
+  /// State of an open source block
+  struct BlockState {
+    int           sbid;            //!< Source block ID, or -1
+    int           kval;            //!< # source symbols of the SB
+    bool          haslast;         //!< Whether the next two are known
+    int           laststream;      //!< Stream of its last source symbol
+    uint32_t      lastlen;         //!< Bytes of data in that symbol
+    int           nrcv;            //!< # syms received for SB
+    int           nsrcrcv;         //!< same, for src syms
+    int           maxesi;          //!< Highest ESI received for SB
+    bool          decoded;         //!< Whether the SB was decoded
+    bool          released;        //!< The decoded data can be released
+    std::unique_ptr<FountainDecoder> code; //!< Decoder, with RealCode
+    SlotState     slots[TX_SLOT_COUNT];    //!< Per stream state
+    std::vector<int> esistream;    //!< Stream of each src sym rcvd
+    std::vector<int> esicounts;    //!< Its iseq counts, m_nslots per ESI
+  };
+
+  /**
+   * \return the state of the open block sbid, or NULL if it is not open
+   */
+  BlockState* GetBlock (int sbid);
+
+  /**
+   * \brief Open the groups of blocks up to the one of sbid, giving up
+   * the groups that leave the window
+   */
+  void OpenBlocks (int sbid);
+
+  /**
+   * \brief Reset the state of the ring slot of sbid for block sbid
+   */
+  void InitBlock (int sbid);
+
+  /**
+   * \brief Give up the oldest open group, which starts at block sbid
+   */
+  void CloseGroup (int sbid);
+
+  /**
+   * \brief Trace and forget a block of the group being given up
+   */
+  void CloseBlock (BlockState* b);
+
+  /**
+   * \return whether source symbol esi of block b holds data of stream
+   * slotID:  1 if it does, 0 if not, -1 if that is not known yet
+   */
+  int HoldsStream (const BlockState& b, int esi, int slotID) const;
+
+  /**
+   * \brief Move the data of stream slotID that the open blocks hold to
+   * the stream, in send order, up to the first symbol not available yet
+   * \param giveUp the group of the next symbol is being given up:  skip
+   * what it lost, and stop at the end of the group
+   */
+  void ReleaseStream (int slotID, bool giveUp);
+
+  /**
+   * \brief ReleaseStream for all streams
+   */
+  void ReleaseHeld (void);
+
+  void PopulateDecodeInfo(const BlockState& b, bool final, DecodeInfo* I);
 
   /**
    * \brief Handle a packet received by the application
@@ -94,24 +219,49 @@ protected:
    */
   virtual void HandleSend(int slotID, Ptr<Socket>, uint32_t sz);
 
+  /**
+   * \brief Report the state of a source block to the encoder
+   */
+  void SendFeedback (const BlockState& b);
+
+  /**
+   * \brief Release the data of a block the CPU finished decoding
+   */
+  void DecodeDone (uint32_t sbid, Time queueing, Time decoding);
+
   // RQ configuration parameters
   int             m_rqkval;        //!< Source block size in packets
   int             m_rqnval;        //!< Encoded block size in packets
   uint32_t        m_rqtval;        //!< Packet size
+  bool            m_useRealCode;   //!< Decode with a FountainCode
+  bool            m_useCpu;        //!< Delay output by the decoding time
+  bool            m_useFeedback;   //!< Report blocks to the encoder
+
+  uint32_t        m_window;        //!< # of open groups of blocks
+  uint32_t        m_depth;         //!< # of blocks interleaved in a group
 
   // RQ state
-  int		  m_sbid;	   //!< Current source block ID
-  int		  m_sb_nrcv;	   //!< # syms received for SB
-  int             m_sb_nsrcrcv;    //!< same, for src syms
+  int		  m_sbid;	   //!< Newest source block ID
+  std::vector<BlockState> m_blocks; //!< Open blocks, by sbid % size
   int		  m_nslots;	   //!< Count of slots available
-  struct SlotState {
-    uint32_t      m_nbuffered;     //!< # bytes buffered for stream
-    int           m_nsymbcontig;   //!< # contiguous symbs for stream rcvd
-    int		  m_nsymb;         //!< # symbs for that stream in SB
-  } m_slotStates[TX_SLOT_COUNT];
+  uint32_t        m_nbuffered[TX_SLOT_COUNT]; //!< # bytes buffered per stream
+  int             m_relSbid[TX_SLOT_COUNT]; //!< Group of next symb to release
+  int             m_relPos[TX_SLOT_COUNT]; //!< Its ESI * depth + block in group
+  Ptr<Socket>     m_feedbackSocket; //!< Socket the symbols came on
+  Address         m_feedbackAddr;  //!< Address the symbols came from
+
+  /// A block on the CPU, and the data released once it is decoded if
+  /// the block was given up meanwhile
+  struct DecodeJob {
+    uint32_t sbid;                        //!< Source block ID
+    uint32_t release[TX_SLOT_COUNT];      //!< # bytes per stream
+  };
+  Ptr<DecoderCpu>         m_cpu;           //!< CPU, with DecodeCpu
+  std::list<DecodeJob>    m_decodeJobs;    //!< Blocks being decoded
 
   // RQ decoder event traces
   TracedCallback< const DecodeInfo& > m_rqDecodingTrace;
+  TracedCallback<uint32_t, Time, Time> m_decodeDelayTrace;
 };
 
 } // namespace ns3
@@ -1,4 +1,6 @@
+#include <algorithm>
 #include <cassert>
+#include <vector>
 
 #include "ns3/address.h"
 #include "ns3/address-utils.h"
@@ -20,6 +22,7 @@
 #include "ns3/udp-socket.h"
 #include "ns3/uinteger.h"
 
+#include "rq-feedback-header.h"
 #include "rq-header.h"
 #include "rq-encoder.h"
 
@@ -58,6 +61,53 @@ RqEncoder::GetTypeId (void)
                      DataRateValue (DataRate ("5Mbps")),
                      MakeDataRateAccessor (&RqEncoder::m_sendingRate),
                      MakeDataRateChecker ())
+      .AddAttribute ("MaxBurst",
+                     "The most symbols to send in a tick, when behind "
+                     "schedule after waiting for TX buffer space",
+                     UintegerValue (1),
+                     MakeUintegerAccessor (&RqEncoder::m_maxBurst),
+                     MakeUintegerChecker<uint32_t> (1))
+      .AddAttribute ("CompactHeader",
+                     "Whether to use the compact (varint) RQ header encoding",
+                     BooleanValue (false),
+                     MakeBooleanAccessor (&RqEncoder::m_compactHeader),
+                     MakeBooleanChecker ())
+      .AddAttribute ("Feedback",
+                     "Whether to end blocks the decoder reports decoded, "
+                     "and to adapt the symbols per block to the loss "
+                     "it reports",
+                     BooleanValue (false),
+                     MakeBooleanAccessor (&RqEncoder::m_useFeedback),
+                     MakeBooleanChecker ())
+      .AddAttribute ("TargetReliability",
+                     "With Feedback, the probability with which a block "
+                     "should deliver K symbols",
+                     DoubleValue (0.99),
+                     MakeDoubleAccessor (&RqEncoder::m_targetReliability),
+                     MakeDoubleChecker<double> (0, 1))
+      .AddAttribute ("LossGain",
+                     "With Feedback, the gain of the moving average of "
+                     "the delivery ratios reported",
+                     DoubleValue (0.125),
+                     MakeDoubleAccessor (&RqEncoder::m_lossGain),
+                     MakeDoubleChecker<double> (0, 1))
+      .AddAttribute ("InterleaveDepth",
+                     "The number of source blocks whose symbols are "
+                     "interleaved",
+                     UintegerValue (1),
+                     MakeUintegerAccessor (&RqEncoder::m_depth),
+                     MakeUintegerChecker<uint32_t> (1))
+      .AddAttribute ("MaxBlockLatency",
+                     "The time after which a block with source data "
+                     "waiting is closed with fewer than K source symbols "
+                     "(0 for never)",
+                     TimeValue (Seconds (0)),
+                     MakeTimeAccessor (&RqEncoder::m_maxBlockLatency),
+                     MakeTimeChecker ())
+      .AddTraceSource ("BlockLatency",
+                     "All source symbols of a block were sent",
+                     MakeTraceSourceAccessor (&RqEncoder::m_blockLatencyTrace),
+                     "ns3::RqEncoder::BlockLatencyCallback")
     ;
     ProxyBase::SetTidDefaultProtocols(&tid,
                      TcpSocketFactory::GetTypeId(),
@@ -74,9 +124,25 @@ RqEncoder::RqEncoder ()
     m_nRxSlots(0),
     m_nextRxSlot(0),
     m_sendingRate(DataRate("5Mbps")),
+    m_maxBurst(1),
+    m_parked(NOT_PARKED),
+    m_compactHeader(false),
+    m_useFeedback(false),
+    m_targetReliability(0.99),
+    m_lossGain(0.125),
+    m_delivery(-1),
+    m_blockSize(120),
+    m_depth(1),
     m_sbid(0),
+    m_lane(0),
     m_esi(0),
-    m_symbcounts{0}
+    m_lanesDone(0),
+    m_maxBlockLatency(Seconds(0)),
+    m_flushPending(false),
+    m_blockStarted(false),
+    m_blockK(100),
+    m_blockClosed(false),
+    m_shortBlockEnd(0)
 {
   NS_LOG_FUNCTION (this);
 }
@@ -100,81 +166,298 @@ void RqEncoder::StartApplication()
     NS_FATAL_ERROR("At least one RxSlot needs to be set for the RqEncoder app.");
   }
 
-  // Get the packet sending going
+  // Send full blocks until the decoder reports the loss
+  m_delivery = -1;
+  m_blockSize = m_rqnval;
+  m_blockK = m_rqkval;
+  m_symbcounts.assign(m_depth * RX_SLOT_COUNT, 0);
+  m_laneDone.assign(m_depth, false);
+  m_lanesDone = 0;
+  m_flushPending = false;
+  m_blockStarted = false;
+  m_blockClosed = false;
+  m_lastStream.assign(m_depth, -1);
+  m_lastLen.assign(m_depth, 0);
+
+  // Get the packet sending going, with the first tick now
+  m_tickInterval = Seconds(m_rqtval * 8.0 /
+                          double(m_sendingRate.GetBitRate()));
+  m_lastTick = Simulator::Now() - m_tickInterval;
+  m_parked = NOT_PARKED;
   SendPacket();
 }
 
+void RqEncoder::StopApplication()
+{
+  Simulator::Cancel(m_sendEvent);
+  Simulator::Cancel(m_flushEvent);
+  m_parked = NOT_PARKED;
+  ProxyBase::StopApplication();
+}
+
+void RqEncoder::HandleRead(int slotID, Ptr<Socket> socket)
+{
+  // Source data is only read at the ticks, but the block latency
+  // counts from now
+  const uint32_t avail = socket->GetRxAvailable();
+  if (avail > 0 && !m_blockStarted)
+    StartBlockTimer();
+  if (avail >= m_rqtval || (m_flushPending && avail > 0))
+    Wake(PARKED_RX);
+}
+
+void RqEncoder::HandleSend(int slotID, Ptr<Socket> socket, uint32_t sz)
+{
+  if (slotID == 0)
+    Wake(PARKED_TX);
+}
+
+void RqEncoder::HandleBackRead(Ptr<Socket> socket)
+{
+  Ptr<Packet> pkt;
+  while ((pkt = socket->Recv())) {
+    RqFeedbackHeader hdr;
+    if (!m_useFeedback || pkt->PeekHeader(hdr) == 0 || !hdr.IsValid())
+      continue;
+    NS_LOG_INFO("Feedback for block " << hdr.GetSbid()
+                << " decoded " << hdr.IsDecoded()
+                << " received " << hdr.GetNrcv()
+                << " of " << hdr.GetNsent());
+
+    // Update the delivery ratio and the symbols per block
+    if (hdr.GetNsent() > 0) {
+      const double ratio = std::min(1.0,
+                            double(hdr.GetNrcv()) / hdr.GetNsent());
+      m_delivery = m_delivery < 0
+                     ? ratio
+                     : m_delivery + m_lossGain * (ratio - m_delivery);
+      m_blockSize = ComputeBlockSize(m_rqkval);
+    }
+
+    // Stop sending repair symbols for a decoded block, and for the
+    // group once all of its blocks are decoded
+    const uint32_t lane = hdr.GetSbid() - m_sbid;
+    if (hdr.IsDecoded() && hdr.GetSbid() >= m_sbid && lane < m_depth
+        && m_esi >= m_rqkval && !m_laneDone[lane])
+    {
+      m_laneDone[lane] = true;
+      if (++m_lanesDone == m_depth)
+        NextBlock();
+      else if (m_laneDone[m_lane])
+        AdvanceLane();
+    }
+  }
+}
+
+uint32_t RqEncoder::ComputeBlockSize(uint32_t kval) const
+{
+  // There are Nval - Kval repair ESIs, whatever the block K
+  const uint32_t max = kval + m_rqnval - m_rqkval;
+  if (m_delivery <= 0)
+    return max;
+
+  // Distribution of the symbols delivered, up to kval - 1, for n sent
+  std::vector<double> p(kval, 0.0);
+  p[0] = 1.0;
+  for (uint32_t n = 1; n <= max; ++n) {
+    double below = 0;
+    for (uint32_t j = std::min(n, kval - 1); j > 0; --j) {
+      p[j] = p[j] * (1 - m_delivery) + p[j - 1] * m_delivery;
+      below += p[j];
+    }
+    p[0] *= 1 - m_delivery;
+    below += p[0];
+    if (n >= kval && 1 - below >= m_targetReliability)
+      return n;
+  }
+  return max;
+}
+
+void RqEncoder::NextBlock()
+{
+  m_esi = 0;
+  m_lane = 0;
+  m_sbid += m_depth;
+  m_blockK = m_rqkval;
+  m_blockClosed = false;
+  std::fill(m_symbcounts.begin(), m_symbcounts.end(), 0);
+  std::fill(m_laneDone.begin(), m_laneDone.end(), false);
+  m_lanesDone = 0;
+}
+
+void RqEncoder::AdvanceLane()
+{
+  do {
+    // After the last block of the group, on to the next ESI
+    if (++m_lane == m_depth) {
+      m_lane = 0;
+      if (++m_esi == m_blockK)
+        EndSource();
+      if (m_esi >= GetBlockEnd()) {
+        NextBlock();
+        return;
+      }
+    }
+  } while (m_laneDone[m_lane]);
+}
+
+void RqEncoder::StartBlockTimer()
+{
+  m_blockStarted = true;
+  m_blockStart = Simulator::Now();
+  if (m_maxBlockLatency.IsStrictlyPositive())
+    m_flushEvent = Simulator::Schedule(m_maxBlockLatency,
+                          &RqEncoder::FlushBlock, this);
+}
+
+void RqEncoder::FlushBlock()
+{
+  m_flushPending = true;
+  Wake(PARKED_RX);
+}
+
+void RqEncoder::EndSource()
+{
+  for (uint32_t i = 0; i < m_depth; ++i)
+    m_blockLatencyTrace(m_sbid + i, m_blockK,
+                        Simulator::Now() - m_blockStart);
+  Simulator::Cancel(m_flushEvent);
+  m_flushPending = false;
+  m_blockStarted = false;
+
+  // A shortened block sends its repair symbols from ESI Kval on, as
+  // many as its K calls for
+  if (m_blockK < m_rqkval) {
+    m_esi = m_rqkval;
+    const uint32_t repairs = m_useFeedback
+      ? ComputeBlockSize(m_blockK) - m_blockK
+      : ((m_rqnval - m_rqkval) * m_blockK + m_rqkval - 1) / m_rqkval;
+    m_shortBlockEnd = m_rqkval + repairs;
+  }
+
+  // Source data of the next block may be waiting already
+  for (int i = 0; i < m_nRxSlots; ++i) {
+    if (!m_rxSlots[i].accepted_socks.empty()
+        && m_rxSlots[i].accepted_socks.front()->GetRxAvailable() > 0)
+    {
+      StartBlockTimer();
+      break;
+    }
+  }
+}
+
+uint32_t RqEncoder::GetBlockEnd() const
+{
+  if (m_blockK < m_rqkval)
+    return m_shortBlockEnd;
+  return m_useFeedback ? m_blockSize : m_rqnval;
+}
+
+void RqEncoder::Wake(ParkReason reason)
+{
+  if (m_parked != reason || m_sendEvent.IsRunning())
+    return;
+
+  // Resume at the next tick of the grid
+  const int64_t interval = m_tickInterval.GetTimeStep();
+  const int64_t since = (Simulator::Now() - m_lastTick).GetTimeStep();
+  const int64_t ticks = std::max<int64_t>(1,
+                          (since + interval - 1) / interval);
+  const Time next = TimeStep(m_lastTick.GetTimeStep() + ticks * interval);
+  m_sendEvent = Simulator::Schedule(next - Simulator::Now(),
+                          &RqEncoder::SendPacket, this);
+}
+
 void RqEncoder::SendPacket()
 {
+  // Catch up on the ticks missed while waiting for TX space
+  const int64_t ticks = (Simulator::Now() - m_lastTick).GetTimeStep()
+                          / m_tickInterval.GetTimeStep();
+  const uint32_t burst = m_parked == PARKED_TX
+                          ? (uint32_t)std::min<int64_t>(ticks, m_maxBurst)
+                          : 1;
+  m_lastTick = Simulator::Now();
+
+  for (uint32_t i = 0; i < burst; ++i) {
+    m_parked = SendSymbol();
+    if (m_parked != NOT_PARKED) {
+      // Wait for HandleRead or HandleSend to call Wake()
+      return;
+    }
+  }
+
   // Schedule next transmission
-  Time nextTime = Seconds(m_rqtval * 8.0 /
-                          double(m_sendingRate.GetBitRate()));
-  m_sendEvent = Simulator::Schedule(nextTime,
+  m_sendEvent = Simulator::Schedule(m_tickInterval,
                           &RqEncoder::SendPacket, this);
+}
 
-  // Check if we can send data
+RqEncoder::ParkReason RqEncoder::SendSymbol()
+{
+  // Check if we can send data.  The header only carries the block's K
+  // once the block is shortened, which may happen below.
+  const bool short_block = m_blockClosed || m_flushPending;
   if (m_txSlots[0].sock->GetTxAvailable()
-        < m_rqtval + RqHeader::GetMinSerializedSize() + m_nRxSlots * 4)
+        < m_rqtval + RqHeader::GetMaxSerializedSize(m_nRxSlots,
+                                                    m_compactHeader,
+                                                    short_block))
   {
     /* Don't have the buffer space available to send,
      * so skip this time slot
      */
-    return;
+    return PARKED_TX;
   }
 
-  // Retrieve source data.
+  // Retrieve source data, or close the block early if it waited long
+  // enough for it.
   Ptr<Packet> pkt;
   int streamid = -1;
-  if (m_esi < m_rqkval) {
-    const int end = m_nextRxSlot;
-    do {
-      // Advance
-      const int slot = m_nextRxSlot;
-      if (++m_nextRxSlot == m_nRxSlots)
-        m_nextRxSlot = 0;
-
-      // Check whether we can read from this socket.
-      if (m_rxSlots[slot].accepted_socks.empty())
-        continue;
-      Ptr<Socket> sock = m_rxSlots[slot].accepted_socks.front();
-      if (sock->GetRxAvailable() < m_rqtval)
-        continue;
-
-      // Read from the socket
-      Address from, localAddr;
-      sock->GetSockName(localAddr);
-      pkt = sock->Recv(m_rqtval, 0);
-      m_rxSlots[slot].total += pkt->GetSize();
-      m_rxTrace(pkt, from);
-      m_rxTraceWithAddresses(pkt, from, localAddr);
-      streamid = slot;
-
-      // Send out a dummy packet to socket
-      // to work around ns3 TCP flow control bugs
-      sock->Send (Create<Packet> (1));
-
-      // Update received symbol counts
-      m_symbcounts[slot]++;
-
-      // We created the payload, now we can send it.
-      goto packet_created;
-
-    } while (m_nextRxSlot != end);
-
-    // We get here if none of the sockets were readable. In such a case
-    // there is nothing to send out at this point.
-    return;
-  } else {
+  uint32_t len = 0;
+  if (m_esi < m_blockK) {
+    pkt = ReadSource(false, &streamid, &len);
+    if (!pkt && m_flushPending) {
+      pkt = ReadSource(true, &streamid, &len);
+      if (!pkt && m_lane > 0) {
+        // Complete the round of source symbols with padding
+        pkt = Create<Packet> (m_rqtval);
+      }
+      if (pkt) {
+        m_blockK = m_esi + 1;
+        m_blockClosed = true;
+      } else if (m_esi > 0) {
+        m_blockK = m_esi;
+        m_blockClosed = true;
+        EndSource();
+        if (m_esi >= GetBlockEnd())
+          NextBlock();
+      } else {
+        m_flushPending = false;
+      }
+    }
+    if (!pkt && m_esi < m_blockK) {
+      // Nothing to send out at this point.
+      return PARKED_RX;
+    }
+    if (pkt) {
+      // In case this ends up the last source symbol of the block
+      m_lastStream[m_lane] = streamid;
+      m_lastLen[m_lane] = len;
+    }
+  }
+  if (!pkt) {
     // create repair packet
     pkt = Create<Packet> (m_rqtval);
   }
 
-packet_created:
   // Add the RQ header to the payload
-  RqHeader hdr(m_rqnval * (uint64_t)m_sbid + m_esi,
+  // Sequence numbers follow the send order:  a group of D blocks
+  // takes D * Nval of them, ESI by ESI, and block by block within
+  RqHeader hdr(m_rqnval * (uint64_t)m_sbid + m_esi * m_depth + m_lane,
                     streamid,
                     m_nRxSlots,
-                    m_symbcounts);
+                    &m_symbcounts[m_lane * RX_SLOT_COUNT]);
+  hdr.SetCompact(m_compactHeader);
+  if (m_blockClosed)
+    hdr.SetBlockK(m_blockK, m_lastStream[m_lane], m_lastLen[m_lane]);
   pkt->AddHeader(hdr);
 
   // Send.
@@ -186,12 +469,58 @@ packet_created:
         m_rxSlots[0].addr,
         m_txSlots[0].addr);
 
-  // Move to next ESI and possibly next source block
-  if (++m_esi == m_rqnval) {
-    m_esi = 0;
-    ++m_sbid;
-    std::fill_n(m_symbcounts, RX_SLOT_COUNT, 0);
-  }
+  // Move to next block of the group, or next ESI and possibly next
+  // group of source blocks
+  AdvanceLane();
+  return NOT_PARKED;
+}
+
+Ptr<Packet> RqEncoder::ReadSource(bool partial, int *streamid,
+                                  uint32_t *len)
+{
+  const uint32_t need = partial ? 1 : m_rqtval;
+  const int end = m_nextRxSlot;
+  do {
+    // Advance
+    const int slot = m_nextRxSlot;
+    if (++m_nextRxSlot == m_nRxSlots)
+      m_nextRxSlot = 0;
+
+    // Check whether we can read from this socket.
+    if (m_rxSlots[slot].accepted_socks.empty())
+      continue;
+    Ptr<Socket> sock = m_rxSlots[slot].accepted_socks.front();
+    if (sock->GetRxAvailable() < need)
+      continue;
+
+    // Read from the socket
+    Address from, localAddr;
+    sock->GetSockName(localAddr);
+    Ptr<Packet> pkt = sock->Recv(m_rqtval, 0);
+    m_rxSlots[slot].total += pkt->GetSize();
+    m_rxTrace(pkt, from);
+    m_rxTraceWithAddresses(pkt, from, localAddr);
+    *streamid = slot;
+    *len = pkt->GetSize();
+    if (!m_blockStarted)
+      StartBlockTimer();
+
+    // Pad a partial symbol
+    if (pkt->GetSize() < m_rqtval)
+      pkt->AddPaddingAtEnd(m_rqtval - pkt->GetSize());
+
+    // Send out a dummy packet to socket
+    // to work around ns3 TCP flow control bugs
+    sock->Send (Create<Packet> (1));
+
+    // Update received symbol counts
+    m_symbcounts[m_lane * RX_SLOT_COUNT + slot]++;
+
+    return pkt;
+  } while (m_nextRxSlot != end);
+
+  // We get here if none of the sockets were readable.
+  return NULL;
 }
 
 } // Namespace ns3
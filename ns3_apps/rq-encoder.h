@@ -26,6 +26,9 @@
 #include "ns3/ptr.h"
 #include "ns3/traced-callback.h"
 #include "ns3/address.h"
+#include "ns3/nstime.h"
+
+#include <vector>
 
 #include "proxy-base.h"
 
@@ -42,6 +45,40 @@ namespace ns3 {
  * \brief
  * This application simulates an RQ encoder. It receives a TCP stream
  * and then sends a corresponding UDP stream with simulated RQ encoding.
+ *
+ * Symbols are sent at the ticks of a fixed grid, one every
+ * Tval * 8 / DataRate seconds.  While there is no source data to read,
+ * or no space in the TX socket buffer, the encoder schedules no ticks,
+ * and waits for the RX or TX socket callbacks instead; it then resumes
+ * at the next tick of the grid.  After waiting for TX space, it is
+ * behind schedule, and sends up to MaxBurst symbols in the first tick
+ * to catch up.
+ *
+ * With the Feedback attribute, the encoder reads the RqFeedbackHeaders
+ * the RqDecoder sends back on the TX socket.  It stops sending repair
+ * symbols for a block as soon as the decoder reports it decoded, and
+ * keeps a moving average of the symbol delivery ratio, from which it
+ * sends each block with the fewest symbols (between Kval and Nval) that
+ * deliver K of them with probability TargetReliability.  Nval then only
+ * bounds the symbols per block (and is still the ESI space of a block).
+ *
+ * With a MaxBlockLatency, a block whose source data became available
+ * that long ago is closed as soon as no full symbol can be read:  a
+ * partial symbol is padded, and the block ends with the source symbols
+ * sent so far, which its symbols from then on say in the RqHeader,
+ * along with the stream and data length of its last symbol.  Its
+ * repair symbols still start at ESI Kval, as if the missing source
+ * symbols were zero padding, and their number is scaled to the shorter
+ * block.  The BlockLatency trace gives, for every block, the time from
+ * its first source data to its last source symbol.
+ *
+ * With an InterleaveDepth D above 1, the encoder fills and sends D
+ * consecutive source blocks at a time, taking turns symbol by symbol:
+ * the symbols of a group go out as ESI 0 of each of its blocks, then
+ * ESI 1 of each, and so on, so that a burst of losses is spread over D
+ * blocks.  Sequence numbers follow the send order, with D * Nval per
+ * group; the RqDecoder needs the same InterleaveDepth to follow.  Blocks that
+ * end early do so together, after a whole round of symbols.
  */
 class RqEncoder : public ProxyBase
 {
@@ -55,14 +92,93 @@ public:
 
   virtual ~RqEncoder ();
 
+  /**
+   * \brief Called when all source symbols of a block were sent
+   * \param sbid the source block ID
+   * \param kval the number of source symbols of the block
+   * \param latency the time since the first source data of the block
+   */
+  typedef void (*BlockLatencyCallback)(uint32_t sbid, uint32_t kval,
+                                       Time latency);
+
 protected:
   virtual void StartApplication();
+  virtual void StopApplication();
+
+  virtual void HandleRead (int slotID, Ptr<Socket> socket);
+  virtual void HandleSend (int slotID, Ptr<Socket> socket, uint32_t sz);
+  virtual void HandleBackRead (Ptr<Socket> socket);
+
+  /** What the encoder is waiting for, if anything */
+  enum ParkReason {
+    NOT_PARKED,
+    PARKED_RX,                     //!< Waiting for source data
+    PARKED_TX                      //!< Waiting for TX buffer space
+  };
 
   /**
-   *\brief Sends traffic packet, if appropriate.
+   *\brief Sends the traffic packets of a tick, and schedules the next
+   * tick unless the encoder has to wait.
    */
   void SendPacket();
 
+  /**
+   *\brief Sends one symbol, if there is source data and TX space.
+   * \return NOT_PARKED if a symbol was sent, or what is missing
+   */
+  ParkReason SendSymbol();
+
+  /**
+   *\brief Schedule the next tick, if the encoder waits for reason
+   */
+  void Wake(ParkReason reason);
+
+  /**
+   *\brief Move on to the next group of source blocks
+   */
+  void NextBlock();
+
+  /**
+   *\brief Move on to the next symbol, skipping the blocks the decoder
+   * reported decoded
+   */
+  void AdvanceLane();
+
+  /**
+   *\brief Read a symbol of source data, or with partial, whatever is
+   * there (padded to a symbol)
+   * \param streamid the RX slot read from is written here
+   * \param len the bytes of data read (before padding) are written here
+   * \return the symbol, or NULL if there is not enough data
+   */
+  Ptr<Packet> ReadSource(bool partial, int *streamid, uint32_t *len);
+
+  /**
+   *\brief Start timing the source data of a block
+   */
+  void StartBlockTimer();
+
+  /**
+   *\brief Make the current block end early, at its next source symbol
+   */
+  void FlushBlock();
+
+  /**
+   *\brief Move on to the repair symbols, after the last source symbol
+   */
+  void EndSource();
+
+  /**
+   *\return the ESI after the last symbol of the current block
+   */
+  uint32_t GetBlockEnd() const;
+
+  /**
+   *\return the fewest symbols per block that deliver kval of them with
+   * probability TargetReliability, at the estimated delivery ratio
+   */
+  uint32_t ComputeBlockSize(uint32_t kval) const;
+
   // RQ configuration parameters
   uint32_t        m_rqkval;        //!< Source block size in packets
   uint32_t        m_rqnval;        //!< Encoded block size in packets
@@ -75,11 +191,41 @@ protected:
   // Data sending state
   EventId         m_sendEvent;
   DataRate	  m_sendingRate;   //!< Data TX rate
+  uint32_t        m_maxBurst;      //!< Most symbols to send in a tick
+  Time            m_tickInterval;  //!< Time between ticks
+  Time            m_lastTick;      //!< Time of the last tick
+  ParkReason      m_parked;        //!< What the encoder is waiting for
+  bool            m_compactHeader; //!< Use the compact RQ header encoding
+
+  // Feedback state
+  bool            m_useFeedback;   //!< Adapt to the decoder's feedback
+  double          m_targetReliability; //!< Target block decoding rate
+  double          m_lossGain;      //!< Gain of the delivery ratio average
+  double          m_delivery;      //!< Delivery ratio, or < 0 if unknown
+  uint32_t        m_blockSize;     //!< Symbols to send per block
 
   // RQ state
-  uint32_t        m_sbid;          //!< Current source block ID (sending)
+  uint32_t        m_depth;         //!< Blocks interleaved
+  uint32_t        m_sbid;          //!< First source block ID of the group
+  uint32_t        m_lane;          //!< Block of the group to send next
   uint32_t        m_esi;           //!< Next symbol ID to send
-  uint32_t        m_symbcounts[RX_SLOT_COUNT]; //!< Symbol counts
+  std::vector<uint32_t> m_symbcounts; //!< Symbol counts, per block
+  std::vector<bool> m_laneDone;    //!< Blocks reported decoded
+  uint32_t        m_lanesDone;     //!< Number of those
+
+  // Block latency state
+  Time            m_maxBlockLatency; //!< Latency to close blocks after
+  EventId         m_flushEvent;    //!< Expiry of the current block
+  bool            m_flushPending;  //!< Close the block at the next symbol
+  bool            m_blockStarted;  //!< Source data of the block arrived
+  Time            m_blockStart;    //!< When it arrived
+  uint32_t        m_blockK;        //!< Source symbols of the current block
+  bool            m_blockClosed;   //!< The group was closed early
+  std::vector<int> m_lastStream;   //!< Stream of each block's last symbol
+  std::vector<uint32_t> m_lastLen; //!< Bytes of data in that symbol
+  uint32_t        m_shortBlockEnd; //!< Block end, for a shortened block
+
+  TracedCallback<uint32_t, uint32_t, Time> m_blockLatencyTrace;
 };
 
 } // namespace ns3
@@ -0,0 +1,123 @@
+#include "rq-feedback-header.h"
+#include "ns3/log.h"
+
+#define MAGIC 0x5246
+
+namespace ns3 {
+NS_LOG_COMPONENT_DEFINE ("RqFeedbackHeader");
+NS_OBJECT_ENSURE_REGISTERED (RqFeedbackHeader);
+
+static const uint32_t SERIALIZED_SIZE = 2 + 4 + 1 + 2 + 2; /* Magic +
+                            sbid + decoded + nrcv + nsent */
+
+RqFeedbackHeader::RqFeedbackHeader ()
+    : m_valid(false),
+      m_sbid(0),
+      m_decoded(false),
+      m_nrcv(0),
+      m_nsent(0)
+{
+}
+
+RqFeedbackHeader::RqFeedbackHeader (uint32_t sbid,
+                bool decoded,
+                uint16_t nrcv,
+                uint16_t nsent)
+    : m_valid(true),
+      m_sbid(sbid),
+      m_decoded(decoded),
+      m_nrcv(nrcv),
+      m_nsent(nsent)
+{
+}
+
+bool RqFeedbackHeader::IsValid (void) const
+{
+    return m_valid;
+}
+
+uint32_t RqFeedbackHeader::GetSbid (void) const
+{
+    return m_sbid;
+}
+
+bool RqFeedbackHeader::IsDecoded (void) const
+{
+    return m_decoded;
+}
+
+uint16_t RqFeedbackHeader::GetNrcv (void) const
+{
+    return m_nrcv;
+}
+
+uint16_t RqFeedbackHeader::GetNsent (void) const
+{
+    return m_nsent;
+}
+
+void RqFeedbackHeader::Print (std::ostream &os) const
+{
+    os << "RqFeedbackHeader"
+       << " valid " << m_valid
+       << " sbid " << m_sbid
+       << " decoded " << m_decoded
+       << " nrcv " << m_nrcv
+       << " nsent " << m_nsent
+       << '\n';
+}
+
+uint32_t RqFeedbackHeader::GetSerializedSize (void) const
+{
+    return SERIALIZED_SIZE;
+}
+
+void
+RqFeedbackHeader::Serialize (Buffer::Iterator start) const
+{
+    Buffer::Iterator i = start;
+    i.WriteHtonU16 (MAGIC);
+    i.WriteHtonU32 (m_sbid);
+    i.WriteU8 (m_decoded ? 1 : 0);
+    i.WriteHtonU16 (m_nrcv);
+    i.WriteHtonU16 (m_nsent);
+}
+
+uint32_t RqFeedbackHeader::Deserialize (Buffer::Iterator start)
+{
+    m_valid = false;
+
+    /* Invalid or truncated headers are not decoded any further */
+    Buffer::Iterator i = start;
+    if (i.GetRemainingSize () < SERIALIZED_SIZE
+        || i.ReadNtohU16 () != MAGIC)
+    {
+        return i.GetDistanceFrom (start);
+    }
+    m_sbid = i.ReadNtohU32 ();
+    m_decoded = i.ReadU8 () != 0;
+    m_nrcv = i.ReadNtohU16 ();
+    m_nsent = i.ReadNtohU16 ();
+    m_valid = true;
+
+    return SERIALIZED_SIZE;
+}
+
+TypeId RqFeedbackHeader::GetTypeId (void)
+{
+    static TypeId tid = TypeId ("ns3::RqFeedbackHeader")
+        .SetParent<Header> ()
+        .SetGroupName("Network")
+        ;
+    return tid;
+}
+
+TypeId RqFeedbackHeader::GetInstanceTypeId (void) const
+{
+    return GetTypeId ();
+}
+
+
+} // namespace ns3
+
+// vim:sts=4:ts=8:sw=4:et
@@ -0,0 +1,63 @@
+#ifndef RQ_FEEDBACK_HEADER_H
+#define RQ_FEEDBACK_HEADER_H
+
+#include <stdint.h>
+
+#include "ns3/header.h"
+
+namespace ns3 {
+/**
+ * \brief Packet header of the feedback from RqDecoder to RqEncoder
+ *
+ * Reports, for a source block, whether it was decoded, how many of its
+ * symbols were received, and how many were sent as far as the decoder
+ * can tell (one more than the highest ESI received), which gives the
+ * encoder the symbol loss rate.  The header has a fixed size of 11
+ * bytes.
+ */
+
+class RqFeedbackHeader : public Header
+{
+public:
+    RqFeedbackHeader ();
+    RqFeedbackHeader (uint32_t sbid,
+            bool decoded,
+            uint16_t nrcv,
+            uint16_t nsent);
+
+    bool IsValid (void) const;
+
+    uint32_t GetSbid (void) const;
+    bool IsDecoded (void) const;
+
+    /** \return the number of symbols received for the source block */
+    uint16_t GetNrcv (void) const;
+
+    /** \return one more than the highest ESI received */
+    uint16_t GetNsent (void) const;
+
+    /**
+     * \brief Get the type ID.
+     * \return the object TypeId
+     */
+    static TypeId GetTypeId (void);
+
+    virtual TypeId GetInstanceTypeId (void) const;
+    virtual void Print (std::ostream &os) const;
+    virtual uint32_t GetSerializedSize (void) const;
+    virtual void Serialize (Buffer::Iterator start) const;
+    virtual uint32_t Deserialize (Buffer::Iterator start);
+
+private:
+    bool     m_valid;
+    uint32_t m_sbid;
+    bool     m_decoded;
+    uint16_t m_nrcv;
+    uint16_t m_nsent;
+};
+
+}
+
+#endif /* RQ_FEEDBACK_HEADER_H */
+
+// vim:sts=4:ts=8:sw=4:et
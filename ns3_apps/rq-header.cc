@@ -3,15 +3,62 @@
 #include "rq-header.h"
 #include "ns3/log.h"
 
-#define MAGIC     0x5271480d
+#define MAGIC         0x5271480d
+#define MAGIC_SHORT   0x5271530d
+#define MAGIC_COMPACT 0x5243
+#define MAGIC_COMPACT_SHORT 0x5253
 
 namespace ns3 {
 NS_LOG_COMPONENT_DEFINE ("RqHeader");
 NS_OBJECT_ENSURE_REGISTERED (RqHeader);
 
+/** Bytes of the fixed size fields of the full encoding */
+static const uint32_t FULL_FIXED_SIZE = 4 + 8 + 4 + 4; /* Magic +
+                            sequence number + iseq_streamid +
+                            iseq_data_count */
+
+static uint32_t VarintSize (uint64_t v)
+{
+    uint32_t n = 1;
+    while (v >= 0x80) {
+        v >>= 7;
+        ++n;
+    }
+    return n;
+}
+
+static void WriteVarint (Buffer::Iterator* i, uint64_t v)
+{
+    while (v >= 0x80) {
+        i->WriteU8 (uint8_t(v | 0x80));
+        v >>= 7;
+    }
+    i->WriteU8 (uint8_t(v));
+}
+
+/** Read a varint, or return false if the buffer ends before it does */
+static bool ReadVarint (Buffer::Iterator* i, uint64_t* v)
+{
+    *v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (i->GetRemainingSize () == 0)
+            return false;
+        const uint8_t b = i->ReadU8 ();
+        *v |= uint64_t(b & 0x7f) << shift;
+        if (!(b & 0x80))
+            return true;
+    }
+    return false;
+}
+
 RqHeader::RqHeader (uint64_t seqno)
     : m_valid(true),
-      m_seqno(0)
+      m_compact(false),
+      m_seqno(0),
+      m_iseq_count(0),
+      m_kval(0),
+      m_laststream(-1),
+      m_lastlen(0)
 {
     m_valid = false;
     m_seqno = 0;
@@ -24,12 +71,16 @@ RqHeader::RqHeader (uint64_t seqno,
                 const uint32_t* iseq_data
                 )
     : m_valid(true),
+      m_compact(false),
       m_seqno(seqno),
-      m_iseq_streamid(iseq_streamid)
+      m_iseq_streamid(iseq_streamid),
+      m_iseq_count(iseq_count),
+      m_kval(0),
+      m_laststream(-1),
+      m_lastlen(0)
 {
-    std::copy(iseq_data,
-            iseq_data + iseq_count,
-            std::back_inserter(m_iseq_data));
+    NS_ASSERT (iseq_count >= 0 && iseq_count <= MAX_ISEQ_COUNT);
+    std::copy(iseq_data, iseq_data + iseq_count, m_iseq_data);
 }
 
 bool RqHeader::IsValid (void) const
@@ -37,6 +88,16 @@ bool RqHeader::IsValid (void) const
     return m_valid;
 }
 
+void RqHeader::SetCompact (bool compact)
+{
+    m_compact = compact;
+}
+
+bool RqHeader::IsCompact (void) const
+{
+    return m_compact;
+}
+
 uint64_t RqHeader::GetSeqno (void) const
 {
     return m_seqno;
@@ -47,19 +108,51 @@ int RqHeader::GetIseqStreamID (void) const
     return m_iseq_streamid;
 }
 
-const std::vector<int>& RqHeader::GetIseqData (void) const
+int RqHeader::GetIseqCount (void) const
+{
+    return m_iseq_count;
+}
+
+const int* RqHeader::GetIseqData (void) const
 {
     return m_iseq_data;
 }
 
+void RqHeader::SetBlockK (uint32_t kval, int last_streamid,
+                          uint32_t last_len)
+{
+    m_kval = kval;
+    m_laststream = last_streamid;
+    m_lastlen = last_len;
+}
+
+uint32_t RqHeader::GetBlockK (void) const
+{
+    return m_kval;
+}
+
+int RqHeader::GetLastStreamID (void) const
+{
+    return m_laststream;
+}
+
+uint32_t RqHeader::GetLastLength (void) const
+{
+    return m_lastlen;
+}
+
 void RqHeader::Print (std::ostream &os) const
 {
     os << "RqHeader"
        << " valid " << m_valid
+       << " compact " << m_compact
        << " seqno " << m_seqno
        << " iseq_streamid " << m_iseq_streamid
+       << " kval " << m_kval
+       << " laststream " << m_laststream
+       << " lastlen " << m_lastlen
        << " iseq_data";
-    for (int i = 0; i < (int)m_iseq_data.size(); ++i) {
+    for (int i = 0; i < m_iseq_count; ++i) {
         os << ' ' << m_iseq_data[i];
     }
     os << '\n';
@@ -67,48 +160,150 @@ void RqHeader::Print (std::ostream &os) const
 
 uint32_t RqHeader::GetSerializedSize (void) const
 {
-    return GetMinSerializedSize() + 4 * (int)m_iseq_data.size();
+    if (!m_compact)
+        return FULL_FIXED_SIZE + 4 * m_iseq_count + (m_kval ? 12 : 0);
+
+    uint32_t size = 2 + VarintSize (m_seqno)
+        + VarintSize (uint32_t(m_iseq_streamid + 1))
+        + VarintSize (m_iseq_count);
+    for (int j = 0; j < m_iseq_count; ++j) {
+        size += VarintSize (uint32_t(m_iseq_data[j]));
+    }
+    if (m_kval) {
+        size += VarintSize (m_kval)
+            + VarintSize (uint32_t(m_laststream + 1))
+            + VarintSize (m_lastlen);
+    }
+    return size;
 }
 
-/** The smallest possible serialized size */
 uint32_t RqHeader::GetMinSerializedSize (void)
 {
-    return 4 + 8 + 4 + 4; /* Magic + sequence number +
+    return 2 + 1 + 1 + 1; /* Compact magic + sequence number +
                              iseq_streamid + iseq_data_count */
 }
 
+uint32_t RqHeader::GetMaxSerializedSize (int iseq_count, bool compact,
+                                         bool short_block)
+{
+    if (!compact)
+        return FULL_FIXED_SIZE + 4 * iseq_count + (short_block ? 12 : 0);
+
+    /* A varint of 64 bits takes up to 10 bytes, of 32 bits up to 5 */
+    return 2 + 10 + 5 + VarintSize (iseq_count) + 5 * iseq_count
+        + (short_block ? 3 * 5 : 0);
+}
+
 void
 RqHeader::Serialize (Buffer::Iterator start) const
 {
     Buffer::Iterator i = start;
-    i.WriteHtonU32 (MAGIC);
+    if (m_compact) {
+        /* Stream id -1 (repair symbols) is encoded as 0 */
+        i.WriteHtonU16 (m_kval ? MAGIC_COMPACT_SHORT : MAGIC_COMPACT);
+        WriteVarint (&i, m_seqno);
+        WriteVarint (&i, uint32_t(m_iseq_streamid + 1));
+        WriteVarint (&i, m_iseq_count);
+        for (int j = 0; j < m_iseq_count; ++j) {
+            WriteVarint (&i, uint32_t(m_iseq_data[j]));
+        }
+        if (m_kval) {
+            WriteVarint (&i, m_kval);
+            WriteVarint (&i, uint32_t(m_laststream + 1));
+            WriteVarint (&i, m_lastlen);
+        }
+        return;
+    }
+
+    i.WriteHtonU32 (m_kval ? MAGIC_SHORT : MAGIC);
     i.WriteHtonU64 (m_seqno);
     i.WriteHtonU32 (m_iseq_streamid);
-    i.WriteHtonU32 (int(m_iseq_data.size()));
-    for (int j = 0; j < (int)m_iseq_data.size(); ++j) {
+    i.WriteHtonU32 (m_iseq_count);
+    for (int j = 0; j < m_iseq_count; ++j) {
         i.WriteHtonU32 (m_iseq_data[j]);
     }
+    if (m_kval) {
+        i.WriteHtonU32 (m_kval);
+        i.WriteHtonU32 (m_laststream);
+        i.WriteHtonU32 (m_lastlen);
+    }
 }
 
 uint32_t RqHeader::Deserialize (Buffer::Iterator start)
 {
-    m_iseq_data.clear();
+    m_valid = false;
     m_seqno = 0;
+    m_iseq_count = 0;
+    m_kval = 0;
+    m_laststream = -1;
+    m_lastlen = 0;
 
+    /* Invalid or truncated headers are not decoded any further */
     Buffer::Iterator i = start;
-    uint32_t magic = i.ReadNtohU32();
-    m_valid = (magic == MAGIC);
-    if (!m_valid) {
-        /* Invalid, don't try to decode the rest */
-        return 4;
+    if (i.GetRemainingSize () < 2)
+        return i.GetDistanceFrom (start);
+    const uint16_t magic = i.ReadNtohU16 ();
+
+    if (magic == MAGIC_COMPACT || magic == MAGIC_COMPACT_SHORT) {
+        uint64_t streamid, count, v, kval = 0, laststream = 0, lastlen = 0;
+        if (!ReadVarint (&i, &m_seqno)
+            || !ReadVarint (&i, &streamid)
+            || !ReadVarint (&i, &count)
+            || count > MAX_ISEQ_COUNT)
+        {
+            return i.GetDistanceFrom (start);
+        }
+        for (int j = 0; j < int(count); ++j) {
+            if (!ReadVarint (&i, &v))
+                return i.GetDistanceFrom (start);
+            m_iseq_data[j] = int(v);
+        }
+        if (magic == MAGIC_COMPACT_SHORT
+            && (!ReadVarint (&i, &kval)
+                || !ReadVarint (&i, &laststream)
+                || !ReadVarint (&i, &lastlen)))
+        {
+            return i.GetDistanceFrom (start);
+        }
+        m_iseq_streamid = int(streamid) - 1;
+        m_iseq_count = int(count);
+        m_kval = uint32_t(kval);
+        m_laststream = int(laststream) - 1;
+        m_lastlen = uint32_t(lastlen);
+        m_compact = true;
+        m_valid = true;
+        return i.GetDistanceFrom (start);
+    }
+
+    if (magic != (MAGIC >> 16)
+        || i.GetRemainingSize () < FULL_FIXED_SIZE - 2)
+    {
+        return i.GetDistanceFrom (start);
     }
+    const uint16_t magic_lo = i.ReadNtohU16 ();
+    const bool short_block = magic_lo == (MAGIC_SHORT & 0xffff);
+    if (magic_lo != (MAGIC & 0xffff) && !short_block)
+        return i.GetDistanceFrom (start);
     m_seqno = i.ReadNtohU64 ();
     m_iseq_streamid = i.ReadNtohU32 ();
 
-    int iseq_sz = i.ReadNtohU32 ();
-    for (int j = 0; j < iseq_sz; ++j) {
-        m_iseq_data.push_back (i.ReadNtohU32 ());
+    const uint32_t iseq_sz = i.ReadNtohU32 ();
+    if (iseq_sz > MAX_ISEQ_COUNT
+        || i.GetRemainingSize () < 4 * iseq_sz + (short_block ? 12 : 0))
+    {
+        return i.GetDistanceFrom (start);
+    }
+    for (uint32_t j = 0; j < iseq_sz; ++j) {
+        m_iseq_data[j] = i.ReadNtohU32 ();
+    }
+    if (short_block) {
+        m_kval = i.ReadNtohU32 ();
+        m_laststream = i.ReadNtohU32 ();
+        m_lastlen = i.ReadNtohU32 ();
     }
+    m_iseq_count = iseq_sz;
+    m_compact = false;
+    m_valid = true;
 
     return GetSerializedSize ();
 }
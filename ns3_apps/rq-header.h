@@ -3,18 +3,36 @@
 
 #include <stdint.h>
 #include <string>
-#include <vector>
 
 #include "ns3/header.h"
 
+#include "proxy-base.h"
+
 namespace ns3 {
 /**
  * \brief Packet header for RaptorQ
+ *
+ * The header has two wire encodings, told apart by their magic:  the
+ * full one with fixed size fields (20 + 4 * iseq count bytes), and a
+ * compact one with the sequence number, stream id and iseq values as
+ * varints (typically 5 + iseq count bytes).  Deserialize accepts both.
+ * The iseq values are stored inline, so (de)serializing allocates
+ * nothing.
+ *
+ * The symbols of a source block the encoder closed early carry that
+ * block K, and the stream and the length of the data in its last
+ * source symbol, which the encoder padded to T; both encodings have a
+ * second magic for headers with these extra fields (12 bytes, or
+ * varints).
  */
 
 class RqHeader : public Header
 {
 public:
+    enum {
+        /** Most iseq values a header can carry */
+        MAX_ISEQ_COUNT = ProxyBase::RX_SLOT_COUNT
+    };
 
     /**
      * \brief Constructor
@@ -29,6 +47,12 @@ public:
 
     bool IsValid (void) const;
 
+    /**
+     * \brief Use the compact encoding when serializing
+     */
+    void SetCompact (bool compact);
+    bool IsCompact (void) const;
+
     /**
      * \return the id for this RqHeader
      */
@@ -36,7 +60,20 @@ public:
 
     int GetIseqStreamID (void) const;
 
-    const std::vector<int>& GetIseqData (void) const;
+    int GetIseqCount (void) const;
+    const int* GetIseqData (void) const;
+
+    /**
+     * \brief Set the number of source symbols of a block closed early
+     * \param kval the block K, or 0 for a block that was not
+     * \param last_streamid the stream of the last source symbol, or -1
+     * for padding
+     * \param last_len the bytes of stream data in that symbol
+     */
+    void SetBlockK (uint32_t kval, int last_streamid, uint32_t last_len);
+    uint32_t GetBlockK (void) const;
+    int GetLastStreamID (void) const;
+    uint32_t GetLastLength (void) const;
 
     /**
      * \brief Get the type ID.
@@ -50,14 +87,27 @@ public:
     virtual void Serialize (Buffer::Iterator start) const;
     virtual uint32_t Deserialize (Buffer::Iterator start);
 
+    /** The smallest possible serialized size, in either encoding */
     static uint32_t GetMinSerializedSize (void);
 
+    /** The largest possible serialized size with iseq_count values,
+     *  in the compact or full encoding, with or without the fields of
+     *  a block closed early
+     */
+    static uint32_t GetMaxSerializedSize (int iseq_count, bool compact,
+                                          bool short_block);
+
 private:
     bool     m_valid;
+    bool     m_compact;
     uint64_t m_seqno;
 
     int32_t  m_iseq_streamid;
-    std::vector<int> m_iseq_data;
+    int      m_iseq_count;
+    int      m_iseq_data[MAX_ISEQ_COUNT];
+    uint32_t m_kval;
+    int32_t  m_laststream;
+    uint32_t m_lastlen;
 };
 
 }
@@ -3,6 +3,7 @@
 #include <iostream>
 
 #include "ns3/log.h"
+#include "ns3/packet.h"
 #include "ns3/tcp-socket-factory.h"
 #include "ns3/udp-socket-factory.h"
 #include "ns3/socket.h"
@@ -73,6 +74,14 @@ TimedProxy::~TimedProxy ()
 {
 }
 
+void TimedProxy::GetStoreSize (uint32_t *packets, uint64_t *bytes) const
+{
+  *packets = m_packetStore.size ();
+  *bytes = 0;
+  for (const auto& packet: m_packetStore)
+    *bytes += packet->GetSize ();
+}
+
 void TimedProxy::HandleRead(int slotID, Ptr<Socket> socket)
 {
   Ptr<Packet> packet;
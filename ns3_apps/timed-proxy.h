@@ -17,6 +17,8 @@ public:
   TimedProxy ();
   virtual ~TimedProxy ();
 
+  virtual void GetStoreSize (uint32_t *packets, uint64_t *bytes) const;
+
 protected:
   virtual void HandleRead(int slotID, Ptr<Socket> sock);
 
@@ -18,6 +18,7 @@ The following types of enumerators are available:
     * union
     * list
     * singleton
+    * random, lhs, sobol (sampling enumerators)
 
 For a brief explanation of the enumerators, read up the documentation of
 the corresponding enum_* functions below.
@@ -25,6 +26,7 @@ the corresponding enum_* functions below.
 The get_enumerator_from_dict() is 
 """
 
+import random
 import sys
 
 def enum_cartesian(dict_vars):
@@ -125,6 +127,136 @@ def enum_singleton(vars_dict):
     """
     yield vars_dict
 
+### Sampling enumerators
+#
+# Sampling enumerators draw a fixed number of points from a parameter
+# space, rather than listing all of it.  The parameter space is given
+# by a dict of variable specifications, in one of these forms:
+#
+#   [ v1, v2, ... ]                     one of the listed values
+#   { "min": a, "max": b }              real number in [a, b)
+#   { "min": a, "max": b, "int": true } integer in [a, b]
+#   { "min": a, "max": b, "log": true } real number, log-uniform
+#
+# Each sampler produces points in the unit cube [0, 1)^d, one
+# coordinate per variable (in sorted order of the variable names), which
+# are then mapped onto the variable values.
+
+def _map_unit_value(spec, u):
+    """Map u in [0, 1) to a value of the variable described by spec."""
+    if isinstance(spec, list):
+        return spec[min(int(u * len(spec)), len(spec) - 1)]
+    lo, hi = spec["min"], spec["max"]
+    if spec.get("int", False):
+        return min(lo + int(u * (hi - lo + 1)), hi)
+    if spec.get("log", False):
+        return lo * (float(hi) / lo) ** u
+    return lo + u * (hi - lo)
+
+def _unit_random(ndim, n, seed):
+    rng = random.Random(seed)
+    for i in range(n):
+        yield [ rng.random() for j in range(ndim) ]
+
+def _unit_lhs(ndim, n, seed):
+    # Each dimension is divided into n strata; each stratum is hit by
+    # exactly one point.  The strata are matched across dimensions by
+    # random permutations.
+    rng = random.Random(seed)
+    perms = []
+    for j in range(ndim):
+        p = list(range(n))
+        rng.shuffle(p)
+        perms.append(p)
+    for i in range(n):
+        yield [ (perms[j][i] + rng.random()) / n for j in range(ndim) ]
+
+# Sobol direction numbers (Joe & Kuo, new-joe-kuo-6.21201) for
+# dimensions 2 and up:  (degree s, coefficients a, initial m values)
+_SOBOL_PARAMS = [
+    (1,  0, [1]),
+    (2,  1, [1, 3]),
+    (3,  1, [1, 3, 1]),
+    (3,  2, [1, 1, 1]),
+    (4,  1, [1, 1, 3, 3]),
+    (4,  4, [1, 3, 5, 13]),
+    (5,  2, [1, 1, 5, 5, 17]),
+    (5,  4, [1, 1, 5, 5, 5]),
+    (5,  7, [1, 1, 7, 11, 19]),
+    (5, 11, [1, 1, 5, 1, 1]),
+    (5, 13, [1, 1, 1, 3, 11]),
+    (5, 14, [1, 3, 5, 5, 31]),
+    (6,  1, [1, 3, 3, 9, 7, 49]),
+    (6, 13, [1, 1, 1, 15, 21, 21]),
+    (6, 16, [1, 3, 1, 13, 27, 49]),
+]
+
+_SOBOL_BITS = 32
+
+def _sobol_directions(dim):
+    """Direction numbers V[1..32] for the given dimension (0-based)."""
+    B = _SOBOL_BITS
+    V = [0] * (B + 1)
+    if dim == 0:
+        for k in range(1, B + 1):
+            V[k] = 1 << (B - k)
+        return V
+    s, a, m = _SOBOL_PARAMS[dim - 1]
+    for k in range(1, s + 1):
+        V[k] = m[k - 1] << (B - k)
+    for k in range(s + 1, B + 1):
+        V[k] = V[k - s] ^ (V[k - s] >> s)
+        for j in range(1, s):
+            if (a >> (s - 1 - j)) & 1:
+                V[k] ^= V[k - j]
+    return V
+
+def _unit_sobol(ndim, n, seed):
+    # Gray code construction.  The sequence is randomized by a digital
+    # shift (XOR with a random number per dimension), which preserves
+    # its low discrepancy.
+    if ndim > len(_SOBOL_PARAMS) + 1:
+        raise ValueError("sobol enumerator supports at most %d variables"
+                         % (len(_SOBOL_PARAMS) + 1,))
+    B = _SOBOL_BITS
+    V = [ _sobol_directions(j) for j in range(ndim) ]
+    rng = random.Random(seed)
+    shift = [ rng.getrandbits(B) for j in range(ndim) ]
+    X = [0] * ndim
+    for i in range(n):
+        yield [ float(X[j] ^ shift[j]) / (1 << B) for j in range(ndim) ]
+        # Index of the lowest zero bit of i (1-based)
+        c = 1
+        while (i >> (c - 1)) & 1:
+            c += 1
+        for j in range(ndim):
+            X[j] ^= V[j][c]
+
+_samplers = {
+    "random": _unit_random,
+    "lhs": _unit_lhs,
+    "sobol": _unit_sobol,
+}
+
+def enum_sample(method, vars_spec, n_samples, seed=0):
+    """Produce a sampling enumerator.
+
+    Lazily yields n_samples parameter sets drawn from the space
+    described by vars_spec (see above) with the given sampling method:
+
+        random  independent uniform samples
+        lhs     Latin hypercube sample; each variable's range is split
+                into n_samples strata, each of which gets one sample
+        sobol   scrambled Sobol low discrepancy sequence; works best
+                when n_samples is a power of two
+
+    The same seed always produces the same samples.
+    """
+    names = sorted(vars_spec.keys())
+    for u in _samplers[method](len(names), n_samples, seed):
+        yield { k: _map_unit_value(vars_spec[k], u[j])
+                for j, k in enumerate(names) }
+
 ###
 
 def get_enumerator_from_dict(d):
@@ -147,6 +279,10 @@ def get_enumerator_from_dict(d):
 
     singleton enumerator syntax:
       { "type": "singleton", "vars": { "var_a": value_a, ... } }
+
+    sampling enumerator syntax (type one of random, lhs, sobol):
+      { "type": "lhs", "samples": N, "seed": S,
+        "vars": { "var_a": [ ... ], "var_b": { "min": a, "max": b }, ... } }
     """
     assert type(d) == dict;
     tp = d["type"]
@@ -162,6 +298,8 @@ def get_enumerator_from_dict(d):
         return enum_list(d["list"])
     elif tp == "singleton":
         return enum_singleton(d["vars"])
+    elif tp in _samplers:
+        return enum_sample(tp, d["vars"], d["samples"], d.get("seed", 0))
     sys.stderr.write("Error:  Not a known enumerator type: `%s'\n" % tp)
     return None
 
@@ -216,6 +354,26 @@ def _tests():
             print("Expected:", result)
             print("Got:", r_received)
             sys.exit(1)
+
+    # Sampling enumerators:  sample counts, ranges, reproducibility,
+    # and stratification of lhs and sobol.
+    for tp in [ "random", "lhs", "sobol" ]:
+        d = { "type": tp, "samples": 64, "seed": 7,
+              "vars": { "x": { "min": 0, "max": 1 },
+                        "n": { "min": 1, "max": 8, "int": True },
+                        "proto": [ "tcp", "udp" ] } }
+        r = list(get_enumerator_from_dict(d))
+        ok = len(r) == 64 and r == list(get_enumerator_from_dict(d))
+        ok = ok and all(0 <= p["x"] < 1 and 1 <= p["n"] <= 8
+                        and p["proto"] in [ "tcp", "udp" ] for p in r)
+        if tp != "random":
+            ok = ok and sorted(int(p["x"] * 64) for p in r) \
+                    == list(range(64))
+            ok = ok and sorted(p["n"] for p in r) \
+                    == sorted(list(range(1, 9)) * 8)
+        if not ok:
+            print("Failure in sampling enumerator:", tp)
+            sys.exit(1)
     print("All tests passed OK.")
     sys.exit(0)
 
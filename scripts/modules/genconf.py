@@ -5,7 +5,63 @@ import shutil
 import subprocess
 import sys
 
-def apply_template_to_file(fn_in, indir, outdir, kv):
+class PhpRenderer:
+    """Runs PHP template processes, several of them concurrently.
+
+    Starting the PHP interpreter dominates the time to generate large
+    sweeps, but the processes are independent of each other, so we run
+    up to `jobs` of them at the same time.  Templates can't share a
+    single interpreter process, since they are free to write to their
+    standard output by other means than echo (e.g., routing.txt.php
+    pipes through genroutingtables).
+
+    submit() starts a process, waiting for a slot to become available
+    if all the slots are busy.  finish() waits for all the outstanding
+    processes.
+    """
+
+    def __init__(self, jobs=1):
+        self.jobs = max(1, jobs)
+        self.running = []
+        self.n_started = 0
+        self.n_failed = 0
+
+    def submit(self, args, fn_in, fn_out):
+        while len(self.running) >= self.jobs:
+            self._reap_one()
+        fp_out = open(fn_out, 'w')
+        proc = subprocess.Popen(args, stdout=fp_out)
+        self.running.append((proc, fp_out, fn_in))
+        self.n_started += 1
+
+    def _reap_one(self):
+        # Wait for whichever process finishes first.
+        pid, status = os.wait()
+        for i, (proc, fp_out, fn_in) in enumerate(self.running):
+            if proc.pid == pid:
+                break
+        else:
+            return
+        del self.running[i]
+        proc.returncode = os.waitstatus_to_exitcode(status)
+        self._complete(proc, fp_out, fn_in)
+
+    def _complete(self, proc, fp_out, fn_in):
+        fp_out.close()
+        if proc.returncode != 0:
+            sys.stderr.write("Error: PHP error processing \"%s\".\n"
+              % (fn_in,))
+            self.n_failed += 1
+
+    def finish(self):
+        """Wait for all processes; returns True if they all succeeded."""
+        for proc, fp_out, fn_in in self.running:
+            proc.wait()
+            self._complete(proc, fp_out, fn_in)
+        self.running = []
+        return self.n_failed == 0
+
+def apply_template_to_file(fn_in, indir, outdir, kv, renderer=None):
     # Figure out what the output name is and what conversion action to
     # take.
     ext = ""
@@ -46,8 +102,13 @@ def apply_template_to_file(fn_in, indir, outdir, kv):
         args += [ "_in_dir=%s" % (os.path.realpath(indir),) ]
 
         # Run PHP
+        if renderer is not None:
+            # Errors are reported by renderer.finish()
+            renderer.submit(args, fn_in, fn_out)
+            return True
         fp_out = open(fn_out, 'w')
         ret = subprocess.run(args, stdout=fp_out)
+        fp_out.close()
         if ret.returncode != 0:
             sys.stderr.write("Error: PHP error processing \"%s\".\n"
               % (fn_in,))
@@ -56,15 +117,21 @@ def apply_template_to_file(fn_in, indir, outdir, kv):
     # Success
     return True
 
-def apply_template(indir, outdir, kv):
-    """Processes an entire template directory."""
+def apply_template(indir, outdir, kv, renderer=None):
+    """Processes an entire template directory.
+
+    If a PhpRenderer is given, PHP templates are processed
+    asynchronously by it, and the generated files are only complete
+    after renderer.finish() has returned.
+    """
 
     # Create the output directory
     os.makedirs(outdir, exist_ok=True)
 
     # Apply template to each file
     for fn_in in os.listdir(indir):
-        success = apply_template_to_file(fn_in, indir, outdir, kv)
+        success = apply_template_to_file(fn_in, indir, outdir, kv,
+                                         renderer)
         if not success:
             return False
 
@@ -0,0 +1,127 @@
+#!/usr/bin/env python3
+
+"""
+Sequential replication of simulation runs.
+
+Instead of simulating every parameter point with a fixed number of
+seeds, we keep adding seeds to a point until the confidence interval of
+a chosen run metric is narrow enough, relative to its mean.  Stable
+configurations thus stop after a few seeds, while noisy ones get more.
+
+A replication is described by a dict (typically from JSON):
+
+    {
+      "param": "seed",          parameter holding the seed
+      "first": 1,               first seed value; then first+1, ...
+      "metric": "rate_bps",     run metric (see runmetrics) to watch
+      "tag_rx": "client.*",     connections to compute metrics on
+      "confidence": 0.95,       confidence level: 0.9, 0.95 or 0.99
+      "rel_width": 0.05,        target CI half width relative to mean
+      "min_reps": 3,            always run at least that many seeds
+      "max_reps": 20            never run more than that many seeds
+    }
+"""
+
+import math
+
+# Two sided Student t quantiles, for 1..30 degrees of freedom
+_T_QUANTILES = {
+    0.90: [ 6.314, 2.920, 2.353, 2.132, 2.015, 1.943, 1.895, 1.860,
+            1.833, 1.812, 1.796, 1.782, 1.771, 1.761, 1.753, 1.746,
+            1.740, 1.734, 1.729, 1.725, 1.721, 1.717, 1.714, 1.711,
+            1.708, 1.706, 1.703, 1.701, 1.699, 1.697 ],
+    0.95: [ 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306,
+            2.262, 2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120,
+            2.110, 2.101, 2.093, 2.086, 2.080, 2.074, 2.069, 2.064,
+            2.060, 2.056, 2.052, 2.048, 2.045, 2.042 ],
+    0.99: [ 63.657, 9.925, 5.841, 4.604, 4.032, 3.707, 3.499, 3.355,
+            3.250, 3.169, 3.106, 3.055, 3.012, 2.977, 2.947, 2.921,
+            2.898, 2.878, 2.861, 2.845, 2.831, 2.819, 2.807, 2.797,
+            2.787, 2.779, 2.771, 2.763, 2.756, 2.750 ],
+}
+
+# Normal quantiles, used beyond 30 degrees of freedom
+_Z_QUANTILES = { 0.90: 1.645, 0.95: 1.960, 0.99: 2.576 }
+
+def t_quantile(confidence, dof):
+    """Two sided Student t quantile for the given confidence level."""
+    if confidence not in _T_QUANTILES:
+        raise ValueError("Unsupported confidence level %s" % (confidence,))
+    if dof <= 30:
+        return _T_QUANTILES[confidence][dof - 1]
+    return _Z_QUANTILES[confidence]
+
+def ci_half_width(values, confidence):
+    """Half width of the confidence interval of the mean of values."""
+    n = len(values)
+    if n < 2:
+        return math.inf
+    mean = sum(values) / n
+    var = sum((v - mean) ** 2 for v in values) / (n - 1)
+    return t_quantile(confidence, n - 1) * math.sqrt(var / n)
+
+def _mean_metrics(metrics_list):
+    """Average each numeric metric over a list of metrics dicts."""
+    ret = {}
+    for k in metrics_list[0].keys():
+        vals = [ m[k] for m in metrics_list if m.get(k) is not None ]
+        ret[k] = sum(vals) / len(vals) if vals else None
+    return ret
+
+def replicate(spec, evaluate):
+    """Run seeds for one parameter point until the CI is narrow enough.
+
+    @param  spec
+            the replication description (see module documentation).
+
+    @param  evaluate
+            function evaluate(seed) running a simulation with the given
+            seed, and returning the run metrics dict, or None if the run
+            failed.
+
+    @return a dict with keys
+              n:              number of successful runs
+              mean:           mean of the metric
+              half_width:     CI half width of the metric
+              rel_half_width: half_width relative to |mean|
+              converged:      whether the target width was reached
+              metrics:        all run metrics, averaged over the runs
+              seeds:          the seeds run
+    """
+    confidence = spec.get("confidence", 0.95)
+    target = spec.get("rel_width", 0.05)
+    min_reps = max(2, spec.get("min_reps", 3))
+    max_reps = spec.get("max_reps", 20)
+    seed = spec.get("first", 1)
+
+    results = []
+    seeds = []
+    values = []
+    converged = False
+    while len(seeds) < max_reps:
+        m = evaluate(seed)
+        seeds.append(seed)
+        seed += 1
+        if m is None or m.get(spec["metric"]) is None:
+            continue
+        results.append(m)
+        values.append(m[spec["metric"]])
+        if len(values) < min_reps:
+            continue
+        mean = sum(values) / len(values)
+        hw = ci_half_width(values, confidence)
+        if hw == 0 or (mean != 0 and hw / abs(mean) <= target):
+            converged = True
+            break
+
+    ret = { 'n': len(values), 'converged': converged, 'seeds': seeds,
+            'mean': None, 'half_width': None, 'rel_half_width': None,
+            'metrics': None }
+    if values:
+        mean = sum(values) / len(values)
+        hw = ci_half_width(values, confidence)
+        ret['mean'] = mean
+        ret['half_width'] = hw
+        ret['rel_half_width'] = hw / abs(mean) if mean != 0 else math.inf
+        ret['metrics'] = _mean_metrics(results)
+    return ret
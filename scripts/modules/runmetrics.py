@@ -0,0 +1,116 @@
+#!/usr/bin/env python3
+
+"""
+Summary metrics of a single simulation run.
+
+This computes, directly from the trace files in a run directory, the
+same per-connection summaries that createresultsdb puts into the
+trace_app_rx_summaries and trace_app_pl_summaries tables, and
+aggregates them into a few numbers per run.  It is used by the stagesim
+drivers that need to look at results while a sweep is running.
+
+Run level metrics (see run_metrics()):
+
+    rate_bps        sum of the receive rates of the selected connections
+    min_rate_bps    smallest receive rate among the selected connections
+    loss_frac       largest packet loss fraction among the selected
+                    connections that carry sequence numbers
+    mean_loss_frac  average of the packet loss fractions
+    n_conns         number of selected connections
+"""
+
+import os
+import re
+
+def _read_header(fn):
+    hdr = {}
+    with open(fn, 'r') as fp:
+        for l in fp:
+            if len(l) == 0 or l[0] != '#':
+                break
+            v = l.strip().split(None, 3)
+            if len(v) == 4 and v[2] == '=':
+                hdr[v[1]] = v[3]
+    return hdr
+
+def rx_rate_bps(fn):
+    """Receive rate of a trace-app-rx-*.txt file, or None if empty."""
+    first, last = None, None
+    with open(fn, 'r') as fp:
+        for l in fp:
+            if l[0] == '#':
+                continue
+            t, b = [ int(x) for x in l.split() ]
+            if first is None:
+                first = (t, b)
+            last = (t, b)
+    if first is None:
+        return None
+    if last[0] <= first[0]:
+        return 0.0
+    return (last[1] - first[1]) * 8.e+6 / (last[0] - first[0])
+
+def pl_loss_frac(fn):
+    """Packet loss fraction of a trace-app-pl-*.txt file.
+
+    Returns None if the file has no sequence number information (e.g.,
+    for TCP connections, or incomplete runs).
+    """
+    lost = 0
+    largest = None
+    with open(fn, 'r') as fp:
+        for l in fp:
+            if len(l) == 0 or l[0] == '#':
+                continue
+            v = l.split()
+            if v[0] == 'lost_range':
+                lost += int(v[2]) - int(v[1]) + 1
+            elif v[0] == 'largest_seqno_processed':
+                largest = int(v[1])
+    if largest is None:
+        return None
+    return float(lost) / (largest + 1)
+
+def conn_metrics(run_dir):
+    """Per-connection summaries of a run.
+
+    Returns a list of dicts with keys app_connect_id, tag_rx, tags_tx,
+    rate_bps and loss_frac (the latter two possibly None).
+    """
+    ret = []
+    for fn in sorted(os.listdir(run_dir)):
+        m = re.match("trace-app-rx-([0-9]+)\\.txt$", fn)
+        if m is None:
+            continue
+        path = run_dir + os.sep + fn
+        hdr = _read_header(path)
+        c = { 'app_connect_id': int(m.group(1)),
+              'tag_rx': hdr.get('tag_rx', ''),
+              'tags_tx': hdr.get('tags_tx', ''),
+              'rate_bps': rx_rate_bps(path),
+              'loss_frac': None }
+        pl_path = run_dir + os.sep + "trace-app-pl-%s.txt" % m.group(1)
+        if os.path.exists(pl_path):
+            c['loss_frac'] = pl_loss_frac(pl_path)
+        ret.append(c)
+    return ret
+
+def run_metrics(run_dir, tag_rx=None):
+    """Run level metrics (see module documentation).
+
+    @param  tag_rx
+            if given, a regular expression; only connections whose
+            receiving app tag matches it are taken into account.
+    """
+    conns = conn_metrics(run_dir)
+    if tag_rx is not None:
+        conns = [ c for c in conns if re.match(tag_rx + "$", c['tag_rx']) ]
+    rates = [ c['rate_bps'] or 0.0 for c in conns ]
+    losses = [ c['loss_frac'] for c in conns if c['loss_frac'] is not None ]
+    return {
+        'rate_bps': sum(rates),
+        'min_rate_bps': min(rates) if rates else 0.0,
+        'loss_frac': max(losses) if losses else None,
+        'mean_loss_frac': sum(losses) / len(losses) if losses else None,
+        'n_conns': len(conns),
+    }
@@ -0,0 +1,148 @@
+#!/usr/bin/env python3
+
+"""
+Adaptive one-dimensional parameter search.
+
+Used by stagesim to find operating points (e.g., the highest rate for
+which packet loss stays below 10%) with a handful of simulation runs,
+instead of simulating a dense grid of values.
+
+A search is described by a dict (typically from JSON):
+
+    {
+      "param": "udpCumRate",        parameter to search over
+      "min": 1, "max": 30,          search interval
+      "int": false,                 restrict to integer values
+      "tolerance": 0.25,            stop once the interval is this small
+      "max_rounds": 10,             maximum number of runs per point
+      "tag_rx": "client.*",         connections to compute metrics on
+      "constraint": { "metric": "loss_frac", "max": 0.1 },
+      "objective": { "metric": "rate_bps", "goal": "max" }
+    }
+
+Metrics are the run level metrics of the runmetrics module.
+
+If a constraint is given, the search bisects for the largest parameter
+value for which the constraint holds.  This assumes the constraint
+holds for small values and fails for large ones, as is the case for
+loss as a function of offered rate; for such a parameter, the largest
+feasible value also maximizes goodput.  Without a constraint, a golden
+section search looks for the parameter value optimizing the objective,
+which needs to be unimodal in the parameter.
+"""
+
+import math
+
+def _get_metric(metrics, name):
+    if metrics is None:
+        return None
+    return metrics.get(name)
+
+def _feasible(metrics, constraint):
+    v = _get_metric(metrics, constraint["metric"])
+    if v is None:
+        return False
+    if "max" in constraint and v > constraint["max"]:
+        return False
+    if "min" in constraint and v < constraint["min"]:
+        return False
+    return True
+
+class _Evaluator:
+    """Memoizing wrapper around the evaluate function."""
+
+    def __init__(self, spec, evaluate):
+        self.spec = spec
+        self.evaluate = evaluate
+        self.rounds = []
+        self.memo = {}
+
+    def value(self, x):
+        if self.spec.get("int", False):
+            return int(round(x))
+        return x
+
+    def __call__(self, x):
+        x = self.value(x)
+        if x not in self.memo:
+            m = self.evaluate(x, len(self.rounds))
+            self.memo[x] = m
+            self.rounds.append((x, m))
+        return self.memo[x]
+
+    def exhausted(self):
+        return len(self.rounds) >= self.spec.get("max_rounds", 10)
+
+def _bisect(spec, ev):
+    c = spec["constraint"]
+    tol = spec.get("tolerance", (spec["max"] - spec["min"]) / 100.)
+    lo, hi = ev.value(spec["min"]), ev.value(spec["max"])
+    if _feasible(ev(hi), c):
+        return hi
+    if not _feasible(ev(lo), c):
+        return None
+    while hi - lo > tol and not ev.exhausted():
+        mid = ev.value((lo + hi) / 2.)
+        if mid == lo or mid == hi:
+            break
+        if _feasible(ev(mid), c):
+            lo = mid
+        else:
+            hi = mid
+    return lo
+
+def _golden(spec, ev):
+    obj = spec["objective"]
+    sign = 1 if obj.get("goal", "max") == "max" else -1
+    def f(x):
+        v = _get_metric(ev(x), obj["metric"])
+        return -math.inf if v is None else sign * v
+
+    tol = spec.get("tolerance", (spec["max"] - spec["min"]) / 100.)
+    invphi = (math.sqrt(5) - 1) / 2
+    a, b = spec["min"], spec["max"]
+    c, d = b - invphi * (b - a), a + invphi * (b - a)
+    fc, fd = f(c), f(d)
+    while b - a > tol and not ev.exhausted():
+        if fc >= fd:
+            b, d, fd = d, c, fc
+            c = b - invphi * (b - a)
+            fc = f(c)
+        else:
+            a, c, fc = c, d, fd
+            d = a + invphi * (b - a)
+            fd = f(d)
+
+    # Return the best value seen
+    return max(ev.memo.keys(),
+        key=lambda x: -math.inf if _get_metric(ev.memo[x], obj["metric"])
+            is None else sign * _get_metric(ev.memo[x], obj["metric"]))
+
+def search(spec, evaluate):
+    """Run a search.
+
+    @param  spec
+            the search description (see module documentation).
+
+    @param  evaluate
+            function evaluate(value, round) running a simulation with
+            the searched parameter set to value, and returning the run
+            metrics dict, or None if the run failed.
+
+    @return a dict with keys
+              best:     the parameter value found (None if even the
+                        smallest value violates the constraint)
+              metrics:  the metrics of the run at the best value
+              rounds:   list of (value, metrics) of all the runs, in
+                        order
+    """
+    ev = _Evaluator(spec, evaluate)
+    if "constraint" in spec:
+        best = _bisect(spec, ev)
+    elif "objective" in spec:
+        best = _golden(spec, ev)
+    else:
+        raise ValueError("search needs a constraint or an objective")
+    return { 'best': best,
+             'metrics': ev.memo.get(best),
+             'rounds': ev.rounds }
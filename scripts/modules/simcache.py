@@ -0,0 +1,147 @@
+#!/usr/bin/env python3
+
+"""
+Content addressed cache of simulation results.
+
+A simulation run is fully determined by the generated configuration
+directory (which includes cmdline_args.txt) and the mesh_sim binary that
+executes it.  We hash both into a key; the outputs of a completed run
+are then stored in the cache under that key.  A later run with the same
+key can reuse the stored outputs instead of running the simulation
+again.
+
+Cache layout:
+
+    <cache-dir>/<key>/          outputs of the run (hard links if
+                                possible, copies otherwise)
+    <cache-dir>/<key>/.origin   the run directory the outputs came from
+
+Entries are first assembled in a temporary directory and then renamed
+into place, so a partially stored entry is never visible.
+"""
+
+import hashlib
+import os
+import shutil
+
+# Bump this if the key computation changes in an incompatible way.
+_KEY_VERSION = "simcache-1"
+
+# Files in a run directory that are inputs or bookkeeping, rather than
+# simulation outputs.
+_NON_OUTPUTS = [ "conf", "params.txt", "done_sim", ".origin" ]
+
+# Cache of binary hashes; keyed by (path, size, mtime)
+_binary_hashes = {}
+
+def _hash_file(h, fn):
+    with open(fn, 'rb') as fp:
+        while True:
+            buf = fp.read(1 << 20)
+            if not buf:
+                break
+            h.update(buf)
+
+def hash_binary(fn):
+    """Returns the hex SHA-256 of the file fn.
+
+    Results are cached for the lifetime of the process, since the same
+    binary is typically hashed for every run of a stage.
+    """
+    st = os.stat(fn)
+    k = (os.path.realpath(fn), st.st_size, st.st_mtime)
+    if k not in _binary_hashes:
+        h = hashlib.sha256()
+        _hash_file(h, fn)
+        _binary_hashes[k] = h.hexdigest()
+    return _binary_hashes[k]
+
+def compute_key(conf_dir, mesh_sim, extra_args=[]):
+    """Compute the cache key for a run.
+
+    @param  conf_dir
+            the generated configuration directory of the run.  All
+            files in it are hashed, including cmdline_args.txt.
+
+    @param  mesh_sim
+            path of the mesh_sim binary executing the run.
+
+    @param  extra_args
+            any further command line arguments passed to mesh_sim that
+            are not part of cmdline_args.txt.
+    """
+    h = hashlib.sha256()
+    h.update(_KEY_VERSION.encode())
+    h.update(b"\0binary\0")
+    h.update(hash_binary(mesh_sim).encode())
+    for fn in sorted(os.listdir(conf_dir)):
+        h.update(b"\0file\0")
+        h.update(fn.encode())
+        h.update(b"\0")
+        _hash_file(h, conf_dir + os.sep + fn)
+    for a in extra_args:
+        h.update(b"\0arg\0")
+        h.update(a.encode())
+    return h.hexdigest()
+
+def _link_or_copy(src, dst):
+    try:
+        os.link(src, dst)
+    except OSError:
+        shutil.copy2(src, dst)
+
+def _output_files(run_dir):
+    for fn in sorted(os.listdir(run_dir)):
+        if fn in _NON_OUTPUTS:
+            continue
+        if os.path.isfile(run_dir + os.sep + fn):
+            yield fn
+
+def lookup(cache_dir, key, run_dir):
+    """Populate run_dir with the cached outputs for key.
+
+    Returns True on a cache hit, False otherwise.
+    """
+    entry = cache_dir + os.sep + key
+    if not os.path.isdir(entry):
+        return False
+    for fn in _output_files(entry):
+        dst = run_dir + os.sep + fn
+        if os.path.exists(dst):
+            os.remove(dst)
+        _link_or_copy(entry + os.sep + fn, dst)
+    return True
+
+def store(cache_dir, key, run_dir):
+    """Store the outputs of run_dir in the cache under key.
+
+    Does nothing if there already is an entry for key.  Returns True if
+    an entry was added.
+    """
+    entry = cache_dir + os.sep + key
+    if os.path.isdir(entry):
+        return False
+    os.makedirs(cache_dir, exist_ok=True)
+    tmp = "%s.tmp.%d" % (entry, os.getpid())
+    os.mkdir(tmp)
+    for fn in _output_files(run_dir):
+        _link_or_copy(run_dir + os.sep + fn, tmp + os.sep + fn)
+    with open(tmp + os.sep + ".origin", 'w') as fp:
+        fp.write(os.path.realpath(run_dir) + "\n")
+    try:
+        os.rename(tmp, entry)
+    except OSError:
+        # Somebody else stored the same key concurrently.
+        shutil.rmtree(tmp)
+        return False
+    return True
+
+def lookup_run(cache_dir, mesh_sim, run_dir):
+    """Convenience wrapper:  lookup() for the run in run_dir."""
+    key = compute_key(run_dir + os.sep + "conf", mesh_sim)
+    return lookup(cache_dir, key, run_dir)
+
+def store_run(cache_dir, mesh_sim, run_dir):
+    """Convenience wrapper:  store() for the run in run_dir."""
+    key = compute_key(run_dir + os.sep + "conf", mesh_sim)
+    return store(cache_dir, key, run_dir)
@@ -4,9 +4,9 @@
 using std::fclose;
 using std::fprintf;
 
-AppRqDecCb::AppRqDecCb(FILE* fp_out)
+AppRqDecCb::AppRqDecCb(FILE* fp_out, FILE* cpu_fp_out)
   : fp(fp_out),
-    has_cached(false)
+    cpu_fp(cpu_fp_out)
 {
 }
 
@@ -21,24 +21,43 @@ static void print_decinfo(FILE* fp, const ns3::RqDecoder::DecodeInfo& I)
 
 AppRqDecCb::~AppRqDecCb()
 {
-	/* Flush out cache if necessary */
-	if (has_cached) {
-		print_decinfo(fp, C);
-		has_cached = false;
-	}
+	/* Flush out the blocks still open, in block order */
+	for (const auto& c: cache)
+		print_decinfo(fp, c.second);
+
+	fclose(fp);
+	if (cpu_fp)
+		fclose(cpu_fp);
+}
 
+void AppRqDecCb::replaceFiles(FILE* fp_out, FILE* cpu_fp_out)
+{
 	fclose(fp);
+	if (cpu_fp)
+		fclose(cpu_fp);
+	fp = fp_out;
+	cpu_fp = cpu_fp_out;
 }
 
 void AppRqDecCb::rqDecCb(const ns3::RqDecoder::DecodeInfo& I)
 {
-	/* Check if we need to print a cached input */
-	if (has_cached && C.sbid != I.sbid) {
-		print_decinfo(fp, C);
-		has_cached = false;
+	/* The last DecodeInfo of a block is printed, once it's given up */
+	if (I.final) {
+		cache.erase(I.sbid);
+		print_decinfo(fp, I);
+		return;
 	}
 
 	/* Add new reception to cache */
-	C = I;
-	has_cached = true;
+	cache[I.sbid] = I;
+}
+
+void AppRqDecCb::decodeDelayCb(uint32_t sbid, ns3::Time queueing,
+		ns3::Time decoding)
+{
+	std::fprintf(cpu_fp, "%u %ld %ld %ld\n",
+		sbid,
+		(long int)ns3::Simulator::Now().GetMicroSeconds(),
+		(long int)queueing.GetMicroSeconds(),
+		(long int)decoding.GetMicroSeconds());
 }
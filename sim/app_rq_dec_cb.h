@@ -3,17 +3,29 @@
 #include "rq-decoder.h"
 
 #include <cstdio>
+#include <map>
 
 class AppRqDecCb {
 public:
-	AppRqDecCb(FILE* fp_out);
+	/* cpu_fp_out, if not NULL, receives the decoding delays of the
+	 * blocks decoded by the node's DecoderCpu.
+	 */
+	AppRqDecCb(FILE* fp_out, FILE* cpu_fp_out = NULL);
 	~AppRqDecCb();
 
 	void rqDecCb(const ns3::RqDecoder::DecodeInfo& I);
+	void decodeDelayCb(uint32_t sbid, ns3::Time queueing,
+		ns3::Time decoding);
+
+	/* Close the trace files, and continue writing to the given ones
+	 * instead.
+	 */
+	void replaceFiles(FILE* fp_out, FILE* cpu_fp_out);
 
 private:
 	FILE* fp;
+	FILE* cpu_fp;
 
-	bool has_cached;
-	ns3::RqDecoder::DecodeInfo C;
+	/* The latest DecodeInfo of the blocks not given up yet */
+	std::map<unsigned int, ns3::RqDecoder::DecodeInfo> cache;
 };
@@ -0,0 +1,30 @@
+#include "app_rq_enc_cb.h"
+
+using std::fclose;
+using std::fprintf;
+
+AppRqEncCb::AppRqEncCb(FILE* fp_out)
+  : fp(fp_out)
+{
+}
+
+AppRqEncCb::~AppRqEncCb()
+{
+	fclose(fp);
+}
+
+void AppRqEncCb::replaceFile(FILE* fp_out)
+{
+	fclose(fp);
+	fp = fp_out;
+}
+
+void AppRqEncCb::blockLatencyCb(uint32_t sbid, uint32_t kval,
+		ns3::Time latency)
+{
+	std::fprintf(fp, "%u %u %ld %ld\n",
+		sbid,
+		kval,
+		(long int)ns3::Simulator::Now().GetMicroSeconds(),
+		(long int)latency.GetMicroSeconds());
+}
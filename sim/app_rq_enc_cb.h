@@ -0,0 +1,18 @@
+#include "ns3_all.h"
+
+#include <cstdio>
+
+/** State structure for the block latency trace of an RqEncoder */
+class AppRqEncCb {
+public:
+	AppRqEncCb(FILE* fp_out);
+	~AppRqEncCb();
+
+	void blockLatencyCb(uint32_t sbid, uint32_t kval, ns3::Time latency);
+
+	/* Close the trace file, and continue writing to fp_out */
+	void replaceFile(FILE* fp_out);
+
+private:
+	FILE* fp;
+};
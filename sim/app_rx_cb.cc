@@ -4,6 +4,7 @@
 #include "rq-header.h"
 
 #include "app_rx_cb.h"
+#include "convergence_monitor.h"
 
 using namespace std;
 using namespace ns3;
@@ -13,6 +14,8 @@ AppRxCb::AppRxCb(FILE* rx_byte_fp_,
 		int pl_window_size)
  : rx_byte_fp(rx_byte_fp_),
    rx_byte_count(0),
+   conv_monitor(NULL),
+   conv_flow(-1),
    pl_fp(pl_fp_),
    n_pl_heap_max_sz(pl_window_size),
    n_pl_heap_size(0),
@@ -36,11 +39,30 @@ AppRxCb::~AppRxCb()
 	delete[] pl_heap;
 }
 
+void AppRxCb::replaceFiles(FILE* rx_byte_fp_, FILE* pl_fp_)
+{
+	if (rx_byte_fp)
+		fclose(rx_byte_fp);
+	if (pl_fp)
+		fclose(pl_fp);
+	rx_byte_fp = rx_byte_fp_;
+	pl_fp = pl_fp_;
+}
+
+void AppRxCb::setConvergenceMonitor(ConvergenceMonitor* monitor,
+		int conv_flow_)
+{
+	conv_monitor = monitor;
+	conv_flow = conv_flow_;
+}
+
 void AppRxCb::rxCb(Ptr<const Packet> packet,
 			const Address &address)
 {
 	LogAndUpdateByteCounts(packet);
 	LogAndUpdateLosses(packet);
+	if (conv_monitor)
+		conv_monitor->addBytes(conv_flow, packet->GetSize());
 }
 
 void AppRxCb::LogAndUpdateByteCounts(Ptr<const Packet> packet)
@@ -5,6 +5,8 @@
 
 #include <cstdio>
 
+class ConvergenceMonitor;
+
 /** State structure for the rx trace callback */
 class AppRxCb {
 public:
@@ -15,6 +17,15 @@ public:
 
 	void rxCb(ns3::Ptr<const ns3::Packet> packet,
 		const ns3::Address& address);
+
+	/* Close the trace files, and continue writing to the given ones
+	 * instead.
+	 */
+	void replaceFiles(FILE* rx_byte_fp, FILE* pl_fp);
+
+	/* Feed received bytes into flow conv_flow of monitor */
+	void setConvergenceMonitor(ConvergenceMonitor* monitor,
+		int conv_flow);
 private:
 	/*** byte count related members ***/
 
@@ -26,6 +37,10 @@ private:
 	/* Number of bytes received so far */
 	long int rx_byte_count;
 
+	/* Convergence monitor to feed, or NULL */
+	ConvergenceMonitor* conv_monitor;
+	int conv_flow;
+
 	/*** packet loss measure related members ***/
 
 	void LogAndUpdateLosses(ns3::Ptr<const ns3::Packet> packet);
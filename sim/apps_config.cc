@@ -106,6 +106,27 @@ static bool parseSingleConnectionConfig(AppConnectionConfig* ret,
 	return true;
 }
 
+static bool parseDecoderCpuConfig(DecoderCpuConfig* ret,
+				const vector<string>& tokens)
+{
+	assert(tokens[0] == "decoder_cpu");
+	if (tokens.size() < 2) {
+		cerr << "Error:  Need <ip> for decoder_cpu\n";
+		return false;
+	}
+	if (!read_ip_addr(ret->ip, tokens[1])) {
+		/* Error already printed */
+		return false;
+	}
+	for (int i = 2; i < (int)tokens.size(); ++i) {
+		pair<string, string> kv;
+		if (!ParseAttributeAssignmentSpec(kv, tokens[i]))
+			return false;
+		ret->attribs.push_back(kv);
+	}
+	return true;
+}
+
 bool loadAppsConfig(AppsCompleteConfig* target,
 		    const string& config_file_name)
 {
@@ -141,6 +162,13 @@ bool loadAppsConfig(AppsCompleteConfig* target,
 				return false;
 
 			target->conn.push_back(conn);
+		} else if (tokens[0] == "decoder_cpu") {
+			/* Parse decoder CPU config */
+			DecoderCpuConfig cpu;
+			if (!parseDecoderCpuConfig(&cpu, tokens))
+				return false;
+
+			target->cpu.push_back(cpu);
 		} else {
 			/* Parse app config */
 			AppConfig app;
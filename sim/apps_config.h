@@ -34,9 +34,16 @@ struct AppConnectionConfig {
 	std::vector<std::string> receivers;
 };
 
+/* The decoder CPU of a node (ns3::DecoderCpu) */
+struct DecoderCpuConfig {
+	uint32_t ip;				// An IP address of the node
+	AppConfig::AppAttribs attribs;
+};
+
 struct AppsCompleteConfig {
 	std::vector<AppConfig> app;
 	std::vector<AppConnectionConfig> conn;
+	std::vector<DecoderCpuConfig> cpu;
 };
 
 bool loadAppsConfig(AppsCompleteConfig* target,
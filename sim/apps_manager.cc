@@ -4,8 +4,14 @@
 #include "apps_manager.h"
 #include "app_rx_cb.h"
 #include "app_rq_dec_cb.h"
+#include "app_rq_enc_cb.h"
+#include "convergence_monitor.h"
+#include "io_utils.h"
+#include "mpi_support.h"
+#include "rng_streams.h"
 
 #include "bulk-send-application.h"
+#include "decoder-cpu.h"
 #include "onoff-application.h"
 #include "packet-sink.h"
 #include "rq-encoder.h"
@@ -36,6 +42,8 @@ AppsManager::~AppsManager()
 		delete j;
 	for (auto j: rqDecCbList)
 		delete j;
+	for (auto j: rqEncCbList)
+		delete j;
 }
 
 void AppsManager::setOutDir(const std::string& out_dir_)
@@ -43,32 +51,116 @@ void AppsManager::setOutDir(const std::string& out_dir_)
 	out_dir = out_dir_;
 }
 
+void AppsManager::setFixedStreams(bool fixed_streams_)
+{
+	fixed_streams = fixed_streams_;
+}
+
+void AppsManager::setConvergenceMonitor(ConvergenceMonitor* monitor)
+{
+	conv_monitor = monitor;
+}
+
 bool AppsManager::createApps(const AppsCompleteConfig& cfg,
 				const Addr2NetDevMapping& addr2netdev)
 {
+	/* Give nodes their decoder CPUs, before any decoder looks for one */
+	for (const auto& cc: cfg.cpu) {
+		if (!createDecoderCpu(cc, addr2netdev))
+			return false;
+	}
+
 	/* Create the apps */
 	for (const auto& ca: cfg.app) {
-		if (!createApp(ca, addr2netdev))
+		if (!createApp(next_app_index++, ca, addr2netdev))
 			return false;
 	}
 
 	/* Connect them */
-	int c_index = 0;
-	for (int i = 0; i < (int)cfg.conn.size(); ++i) {
-		if (!createConns(i, &c_index, cfg.conn[i]))
+	for (const auto& cc: cfg.conn) {
+		if (!createConns(next_conn_stmt_index++, &next_conn_index, cc))
 			return false;
 	}
 
 	return true;
 }
 
-bool AppsManager::createApp(const AppConfig& cfg,
+bool AppsManager::moveTraces(const std::string& new_out_dir)
+{
+	for (int i = 0; i < (int)rxCbList.size(); ++i) {
+		const int id = rxCbConnIds[i];
+		FILE* rx_fp = copyAndReopen(traceFileName(out_dir, "rx", id),
+				traceFileName(new_out_dir, "rx", id));
+		FILE* pl_fp = copyAndReopen(traceFileName(out_dir, "pl", id),
+				traceFileName(new_out_dir, "pl", id));
+		if (rx_fp == NULL || pl_fp == NULL) {
+			/* Error already printed */
+			return false;
+		}
+		rxCbList[i]->replaceFiles(rx_fp, pl_fp);
+	}
+	for (int i = 0; i < (int)rqDecCbList.size(); ++i) {
+		const int id = rqDecCbConnIds[i];
+		FILE* fp = copyAndReopen(traceFileName(out_dir, "rqdec", id),
+				traceFileName(new_out_dir, "rqdec", id));
+		if (fp == NULL) {
+			/* Error already printed */
+			return false;
+		}
+		FILE* cpu_fp = NULL;
+		if (rqCpuTraced[i]) {
+			cpu_fp = copyAndReopen(
+					traceFileName(out_dir, "rqcpu", id),
+					traceFileName(new_out_dir, "rqcpu", id));
+			if (cpu_fp == NULL) {
+				/* Error already printed */
+				fclose(fp);
+				return false;
+			}
+		}
+		rqDecCbList[i]->replaceFiles(fp, cpu_fp);
+	}
+	for (int i = 0; i < (int)rqEncCbList.size(); ++i) {
+		const int id = rqEncCbConnIds[i];
+		FILE* fp = copyAndReopen(traceFileName(out_dir, "rqenc", id),
+				traceFileName(new_out_dir, "rqenc", id));
+		if (fp == NULL) {
+			/* Error already printed */
+			return false;
+		}
+		rqEncCbList[i]->replaceFile(fp);
+	}
+
+	out_dir = new_out_dir;
+	return true;
+}
+
+string AppsManager::traceFileName(const string& dir,
+		const char* kind,
+		int sindex) const
+{
+	ostringstream fn;
+	fn << dir << "/trace-app-" << kind << '-'
+	  << setfill('0') << setw(3) << sindex << ".txt";
+	return fn.str();
+}
+
+bool AppsManager::createApp(int app_index,
+				const AppConfig& cfg,
 				const Addr2NetDevMapping& addr2netdev)
 {
 	/* Create the record */
 	AppRecord R{};
 	R.type = cfg.type;
 	R.host_ip = cfg.ip;
+
+	/* With MPI, only the rank simulating the host runs the app.  The
+	 * other ranks keep the record, and an app object that is never
+	 * installed, so that connections can still match protocols and
+	 * resolve addresses.
+	 */
+	Ptr<Node> host = addr2netdev.at(cfg.ip)->GetNode();
+	R.local = host->GetSystemId() == mpiRank();
 	switch (cfg.type) {
 	case AppConfig::APP_UDP_ECHO_CLIENT:
 		R.app = CreateObject<UdpEchoClient>();
@@ -124,6 +216,7 @@ bool AppsManager::createApp(const AppConfig& cfg,
 		R.TxNames.proto = "ProtocolTx0";
 		R.TxNames.address = "TxAddr0";
 		R.has_rx_trace = true;
+		R.has_rq_encoder_trace = true;
 		break;
 	case AppConfig::APP_RQ_DECODER:
 		R.app = CreateObject<RqDecoder>();
@@ -146,6 +239,52 @@ bool AppsManager::createApp(const AppConfig& cfg,
 	/* Set the attributes on the app */
 	setAppAttribs(R.app, cfg.attribs);
 
+	/* ns-3 schedules the start and stop of an app relative to the
+	 * time it is initialized.  That's the same as absolute times
+	 * for apps created before the simulation runs, but apps created
+	 * later on (e.g., in a branch) need their times shifted.
+	 */
+	const Time now = Simulator::Now();
+	if (now.IsStrictlyPositive()) {
+		TimeValue start, stop;
+		R.app->GetAttribute("StartTime", start);
+		R.app->GetAttribute("StopTime", stop);
+		if (start.Get() < now) {
+			cerr << "Error:  App `" << cfg.tag << "' created at "
+			  << now.GetSeconds() << " s, after its start time "
+			  << start.Get().GetSeconds() << " s.\n";
+			return false;
+		}
+		R.app->SetAttribute("StartTime", TimeValue(start.Get() - now));
+		if (!stop.Get().IsZero()) {
+			R.app->SetAttribute("StopTime",
+			  TimeValue(stop.Get() - now));
+		}
+	}
+
+	/* Pin the random streams of the app to its position in the
+	 * config.  This needs to come after setting the attributes, as
+	 * these may replace the random variables.  OnOff has random
+	 * variables of its own, the 3GPP HTTP client and server keep
+	 * theirs in a ThreeGppHttpVariables ("Variables" attribute).
+	 */
+	if (fixed_streams && R.local) {
+		const int64_t base = rngStreamBase(RNG_APP, app_index);
+		Ptr<MeshSimOnOffApplication>
+		  onoff = DynamicCast<MeshSimOnOffApplication>(R.app);
+		PointerValue vars;
+		if (onoff) {
+			int64_t used = onoff->AssignStreams(base);
+			checkRngStreamCount(RNG_APP, app_index, used);
+		} else if (R.app->GetAttributeFailSafe("Variables", vars)
+			   && vars.Get<ThreeGppHttpVariables>())
+		{
+			int64_t used = vars.Get<ThreeGppHttpVariables>()
+				->AssignStreams(base);
+			checkRngStreamCount(RNG_APP, app_index, used);
+		}
+	}
+
 	/* Insert the record into the map */
 	if (rec.find(cfg.tag) != rec.end()) {
 		cerr << "Error:  Application tag name "
@@ -155,9 +294,32 @@ bool AppsManager::createApp(const AppConfig& cfg,
 	rec[cfg.tag] = R;
 
 	/* Install the App on the correct machine */
-	Ptr<Node> host = addr2netdev.at(cfg.ip)->GetNode();
-	host->AddApplication(R.app);
+	if (R.local)
+		host->AddApplication(R.app);
+
+	return true;
+}
+
+bool AppsManager::createDecoderCpu(const DecoderCpuConfig& cfg,
+				const Addr2NetDevMapping& addr2netdev)
+{
+	auto dev = addr2netdev.find(cfg.ip);
+	if (dev == addr2netdev.end()) {
+		cerr << "Error:  decoder_cpu for unknown host "
+		  << Ipv4Address(cfg.ip) << ".\n";
+		return false;
+	}
+	Ptr<Node> node = dev->second->GetNode();
+	if (node->GetObject<DecoderCpu>()) {
+		cerr << "Error:  Host " << Ipv4Address(cfg.ip)
+		  << " already has a decoder CPU.\n";
+		return false;
+	}
 
+	Ptr<DecoderCpu> cpu = CreateObject<DecoderCpu>();
+	for (auto& a: cfg.attribs)
+		cpu->SetAttribute(a.first, StringValue(a.second));
+	node->AggregateObject(cpu);
 	return true;
 }
 
@@ -218,13 +380,15 @@ bool AppsManager::createConns(int conn_index,
 		 * inner loop over j.  Since they're all installed on
 		 * the RX side, that's enough and it avoids installing
 		 * the callbacks multiple times.
+		 *
+		 * With MPI, only the rank simulating the receiver does
+		 * the tracing.
 		 */
+		if (!rec_rx.local)
+			continue;
 		if (rec_rx.has_rx_trace) {
-			ostringstream rx_tr;
-			rx_tr << out_dir
-			  << "/trace-app-rx-"
-			  << setfill('0') << setw(3) << *sindex << ".txt";
-			FILE* rx_byte_fp = fopen(rx_tr.str().c_str(), "w");
+			FILE* rx_byte_fp = fopen(traceFileName(out_dir,
+					"rx", *sindex).c_str(), "w");
 #define WriteHeader(fp) do { \
 		fprintf(fp, "# app_connect_id = %d\n", *sindex); \
 		fprintf(fp, "# connect_stmt_id = %d\n", conn_index); \
@@ -237,31 +401,63 @@ bool AppsManager::createConns(int conn_index,
 	} while (0)
 			WriteHeader(rx_byte_fp);
 
-			ostringstream pl_tr;
-			pl_tr << out_dir
-			  << "/trace-app-pl-"
-			  << setfill('0') << setw(3) << *sindex << ".txt";
-			FILE* pl_fp = fopen(pl_tr.str().c_str(), "w");
+			FILE* pl_fp = fopen(traceFileName(out_dir,
+					"pl", *sindex).c_str(), "w");
 			WriteHeader(pl_fp);
 
 			AppRxCb* S = new AppRxCb(rx_byte_fp, pl_fp, 128);
+			if (conv_monitor) {
+				S->setConvergenceMonitor(conv_monitor,
+					conv_monitor->addFlow(*sindex));
+			}
 			rec_rx.app->TraceConnectWithoutContext("Rx",
 				MakeCallback(&AppRxCb::rxCb, S));
 
 			/* Record the callback so we can later remove it */
 			rxCbList.push_back(S);
+			rxCbConnIds.push_back(*sindex);
 		}
 		if (rec_rx.has_rq_decoder_trace) {
-			ostringstream rqdec_tr;
-			rqdec_tr << out_dir
-			  << "/trace-app-rqdec-"
-			  << setfill('0') << setw(3) << *sindex << ".txt";
-			FILE* fp = fopen(rqdec_tr.str().c_str(), "w");
-
-			AppRqDecCb* S = new AppRqDecCb(fp);
+			FILE* fp = fopen(traceFileName(out_dir,
+					"rqdec", *sindex).c_str(), "w");
+
+			/* Decoding delays, if the decoder uses the CPU */
+			BooleanValue use_cpu(false);
+			rec_rx.app->GetAttributeFailSafe("DecodeCpu", use_cpu);
+			FILE* cpu_fp = NULL;
+			if (use_cpu.Get()) {
+				cpu_fp = fopen(traceFileName(out_dir,
+						"rqcpu", *sindex).c_str(), "w");
+				fprintf(cpu_fp, "# sbid time_us queue_us decode_us\n");
+			}
+
+			AppRqDecCb* S = new AppRqDecCb(fp, cpu_fp);
 			rec_rx.app->TraceConnectWithoutContext("RqDecodingEvent",
 				MakeCallback(&AppRqDecCb::rqDecCb, S));
+			if (cpu_fp) {
+				rec_rx.app->TraceConnectWithoutContext("DecodeDelay",
+					MakeCallback(&AppRqDecCb::decodeDelayCb, S));
+			}
 			rqDecCbList.push_back(S);
+			rqDecCbConnIds.push_back(*sindex);
+			rqCpuTraced.push_back(cpu_fp != NULL);
+		}
+
+		/* The block latencies of an encoder, once even if it
+		 * receives from several connect statements
+		 */
+		if (rec_rx.has_rq_encoder_trace
+		    && rqEncTracedApps.insert(PeekPointer(rec_rx.app)).second)
+		{
+			FILE* fp = fopen(traceFileName(out_dir,
+					"rqenc", *sindex).c_str(), "w");
+			fprintf(fp, "# sbid kval time_us latency_us\n");
+
+			AppRqEncCb* S = new AppRqEncCb(fp);
+			rec_rx.app->TraceConnectWithoutContext("BlockLatency",
+				MakeCallback(&AppRqEncCb::blockLatencyCb, S));
+			rqEncCbList.push_back(S);
+			rqEncCbConnIds.push_back(*sindex);
 		}
 	}
 
@@ -284,7 +480,7 @@ void AppsManager::createConn1(int sindex,
 		rxNames = getNamesFromNameTemplates(rxNames, tx_index);
 
 	/* Make the protocols match */
-	if (txNames.proto != "") {
+	if (txNames.proto != "" && rec_rx.local) {
 		TypeIdValue proto;
 		rec_tx.app->GetAttribute(txNames.proto, proto);
 		rec_rx.app->SetAttribute(rxNames.proto, proto);
@@ -294,7 +490,9 @@ void AppsManager::createConn1(int sindex,
 	Ipv4Address rxAddr(rec_rx.host_ip);
 	const int port = sindex + 1001;
 	assert(txNames.address != ""); // Need to be able to tell where to send.
-	if (txNames.port != "") {
+	if (!rec_tx.local) {
+		/* Simulated by another rank */
+	} else if (txNames.port != "") {
 		rec_tx.app->SetAttribute(txNames.port,
 		  UintegerValue(port));
 		rec_tx.app->SetAttribute(txNames.address,
@@ -309,7 +507,9 @@ void AppsManager::createConn1(int sindex,
 	}
 
 	/* Receiver side: set port and addresses */
-	if (rxNames.port != "") {
+	if (!rec_rx.local) {
+		/* Simulated by another rank */
+	} else if (rxNames.port != "") {
 		rec_rx.app->SetAttribute(rxNames.port,
 		  UintegerValue(port));
 		if (rxNames.address != "") {
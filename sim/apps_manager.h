@@ -1,6 +1,7 @@
 #ifndef APPS_MANAGER_H
 #define APPS_MANAGER_H
 
+#include <set>
 #include <unordered_map>
 #include <string>
 #include <vector>
@@ -11,6 +12,8 @@
 
 class AppRxCb;
 class AppRqDecCb;
+class AppRqEncCb;
+class ConvergenceMonitor;
 
 /**	Utility to manage the applications.
  *
@@ -27,15 +30,47 @@ public:
 	  Addr2NetDevMapping;
 
 	void setOutDir(const std::string& out_dir);
+	void setFixedStreams(bool fixed_streams);
+	void setConvergenceMonitor(ConvergenceMonitor* monitor);
+
+	/** Create apps and their connections.
+	 *
+	 *  This may be called again while the simulation is running, to
+	 *  add further apps.  Their StartTime and StopTime are then
+	 *  still taken as absolute simulation times.
+	 */
 	bool createApps(const AppsCompleteConfig& cfg,
 			const Addr2NetDevMapping& addr2netdev);
 
+	/** Move the trace files to another output directory.
+	 *
+	 *  The traces written so far are copied over, and tracing
+	 *  continues in the copies.  The caller needs to flush all
+	 *  open files before.
+	 */
+	bool moveTraces(const std::string& new_out_dir);
+
 private:
 	/* Input Parameters */
 
 	/* Output directory (used for trace creation) */
 	std::string out_dir;
 
+	/* Whether to assign random streams by app index */
+	bool fixed_streams = false;
+
+	/* Monitor to feed the received bytes of connections into, or
+	 * NULL
+	 */
+	ConvergenceMonitor* conv_monitor = NULL;
+
+	/* Indices of the next app, "connect" statement and individual
+	 * connection to be created
+	 */
+	int next_app_index = 0;
+	int next_conn_stmt_index = 0;
+	int next_conn_index = 0;
+
 	/* Processing data */
 
 	struct AttribNames {
@@ -48,6 +83,7 @@ private:
 		AppConfig::AppType type;
 		ns3::Ptr<ns3::Application> app;
 		uint32_t host_ip;
+		bool local;	// Host simulated by this MPI rank
 
 		bool TxMultiple;
 		AttribNames TxNames;
@@ -57,13 +93,22 @@ private:
 
 		bool has_rx_trace;
 		bool has_rq_decoder_trace;
+		bool has_rq_encoder_trace;
 	};
 
 	/* Map: tag -> AppRecord */
 	std::unordered_map< std::string, AppRecord > rec;
 
 	/* Processing methods */
-	bool createApp(const AppConfig& cfg,
+	bool createApp(int app_index,
+		const AppConfig& cfg,
+		const Addr2NetDevMapping& addr2netdev);
+
+	/** Aggregate a configured DecoderCpu to a node.  Decoders
+	 *  only create one with the default attributes if their node
+	 *  has none.
+	 */
+	bool createDecoderCpu(const DecoderCpuConfig& cfg,
 		const Addr2NetDevMapping& addr2netdev);
 
 	/** Create the connections from a connect statement.
@@ -94,9 +139,22 @@ private:
 			const AttribNames& templ,
 			int index);
 
-	/* Connected callbacks */
+	/** Name of the trace file of the given kind ("rx", "pl",
+	 *  "rqdec", "rqcpu", "rqenc") of a connection.
+	 */
+	std::string traceFileName(const std::string& dir,
+			const char* kind,
+			int sindex) const;
+
+	/* Connected callbacks, with the connection index of each */
 	std::vector< AppRxCb* > rxCbList;
+	std::vector< int > rxCbConnIds;
 	std::vector< AppRqDecCb* > rqDecCbList;
+	std::vector< int > rqDecCbConnIds;
+	std::vector< bool > rqCpuTraced;
+	std::vector< AppRqEncCb* > rqEncCbList;
+	std::vector< int > rqEncCbConnIds;
+	std::set< ns3::Application* > rqEncTracedApps;
 };
 
 #endif /* APPS_MANAGER_H */
@@ -0,0 +1,56 @@
+#include <fstream>
+#include <iostream>
+
+#include <boost/filesystem.hpp>
+
+#include "branch_config.h"
+#include "io_utils.h"
+
+using namespace std;
+namespace filesys = boost::filesystem;
+
+bool loadBranchConfig(vector<branchConfig>* target,
+		      const string& config_file_name)
+{
+	fstream fp(config_file_name);
+	if (!fp) {
+		cerr << "Error:  Could not open branches file \""
+		  << config_file_name << "\"\n";
+		return false;
+	}
+
+	vector<string> tokens;
+	while (getconfiglinetokenized(fp, tokens)) {
+		if (tokens.size() != 2) {
+			cerr << "Error:  Expected <apps-file> <out-dir> in "
+			  "branches file \"" << config_file_name << "\"\n";
+			return false;
+		}
+
+		branchConfig b;
+		b.appsFileName = tokens[0];
+		b.outDir = tokens[1];
+		if (!loadAppsConfig(&b.apps, b.appsFileName)) {
+			/* Error already printed */
+			return false;
+		}
+
+		filesys::path outPath(b.outDir);
+		if (!filesys::exists(outPath)
+		    || !filesys::is_directory(outPath))
+		{
+			cerr << "Error:  Branch out directory \"" << b.outDir
+			  << "\" does not exist or is not a directory\n";
+			return false;
+		}
+
+		target->push_back(b);
+	}
+
+	if (target->empty()) {
+		cerr << "Error:  No branches in \"" << config_file_name
+		  << "\"\n";
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,31 @@
+#ifndef BRANCH_CONFIG_H
+#define BRANCH_CONFIG_H
+
+#include <string>
+#include <vector>
+
+#include "apps_config.h"
+
+/**	A scenario branching off a shared simulation prefix.
+ *
+ *	At the branch time, mesh_sim forks a process per branch.  Each
+ *	of them adds the apps (and connections) of its apps file to the
+ *	ones already running, and continues the simulation with its
+ *	outputs going to its own output directory.
+ */
+struct branchConfig {
+	std::string appsFileName;
+	AppsCompleteConfig apps;
+	std::string outDir;
+};
+
+/**	Load a branches file.
+ *
+ *	Each non-comment line of the file describes a branch as
+ *
+ *		<apps-file> <out-dir>
+ */
+bool loadBranchConfig(std::vector<branchConfig>* target,
+		      const std::string& config_file_name);
+
+#endif /* BRANCH_CONFIG_H */
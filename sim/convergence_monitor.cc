@@ -0,0 +1,171 @@
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+
+#include "convergence_monitor.h"
+
+using namespace std;
+using namespace ns3;
+
+/* Number of bins per MSER-5 batch, and the least number of batches
+ * left after truncation.  (Without the latter, MSER tends to pick the
+ * very end of the series, where a couple of batches may happen to be
+ * almost equal.)
+ */
+static const int MSER_BATCH = 5;
+static const int MSER_MIN_BATCHES = 5;
+
+/* Number of batches for the batch means confidence interval, and the
+ * matching two sided 95% Student t quantile (9 degrees of freedom).
+ */
+static const int CI_BATCHES = 10;
+static const double CI_T_QUANTILE = 2.262;
+
+ConvergenceMonitor::ConvergenceMonitor(double bin_length,
+		double min_duration,
+		double rel_width)
+ : binLength(bin_length),
+   minDuration(min_duration),
+   relWidth(rel_width)
+{
+}
+
+int ConvergenceMonitor::addFlow(int app_connect_id)
+{
+	Flow f;
+	f.appConnectId = app_connect_id;
+	flows.push_back(f);
+	return (int)flows.size() - 1;
+}
+
+void ConvergenceMonitor::start()
+{
+	if (flows.empty()) {
+		cerr << "Warning:  No connections to monitor for "
+		  "convergence.\n";
+		return;
+	}
+	Simulator::Schedule(Seconds(binLength),
+		&ConvergenceMonitor::closeBin,
+		this);
+}
+
+void ConvergenceMonitor::closeBin(void)
+{
+	bool all_stable = true;
+	for (auto& f: flows) {
+		f.rates.push_back(f.binBytes * 8.0 / binLength);
+		f.binBytes = 0;
+		testFlow(&f);
+		all_stable = all_stable && f.stable;
+	}
+
+	const double now = Simulator::Now().GetSeconds();
+	if (all_stable && now >= minDuration - binLength / 2) {
+		converged = true;
+		stopTime = now;
+		printf("+++ All %d monitored connections converged at %.2f s; "
+		       "stopping.\n", (int)flows.size(), now);
+		Simulator::Stop();
+		return;
+	}
+
+	Simulator::Schedule(Seconds(binLength),
+		&ConvergenceMonitor::closeBin,
+		this);
+}
+
+void ConvergenceMonitor::testFlow(Flow* f) const
+{
+	f->stable = false;
+
+	/* MSER-5:  Find the truncation point d (in batches) minimizing
+	 * the squared standard error of the mean of batches d..nb-1.
+	 */
+	const int nb = (int)f->rates.size() / MSER_BATCH;
+	if (nb < MSER_MIN_BATCHES)
+		return;
+	vector<double> z(nb);
+	for (int j = 0; j < nb; ++j) {
+		double s = 0;
+		for (int i = 0; i < MSER_BATCH; ++i)
+			s += f->rates[j * MSER_BATCH + i];
+		z[j] = s / MSER_BATCH;
+	}
+	double sum = 0, sumsq = 0;
+	double best = INFINITY;
+	int best_d = 0;
+	for (int d = nb - 1; d >= 0; --d) {
+		sum += z[d];
+		sumsq += z[d] * z[d];
+		const int m = nb - d;
+		if (m < MSER_MIN_BATCHES)
+			continue;
+		const double sse = sumsq - sum * sum / m;
+		const double mser = sse / ((double)m * m);
+		if (mser <= best) {
+			best = mser;
+			best_d = d;
+		}
+	}
+	f->warmupBins = best_d * MSER_BATCH;
+
+	/* Batch means over the bins after the warm-up */
+	const int n = (int)f->rates.size() - f->warmupBins;
+	const int bsz = n / CI_BATCHES;
+	if (bsz < 1)
+		return;
+	const int first = (int)f->rates.size() - bsz * CI_BATCHES;
+	double bm[CI_BATCHES];
+	double mean = 0;
+	for (int j = 0; j < CI_BATCHES; ++j) {
+		double s = 0;
+		for (int i = 0; i < bsz; ++i)
+			s += f->rates[first + j * bsz + i];
+		bm[j] = s / bsz;
+		mean += bm[j];
+	}
+	mean /= CI_BATCHES;
+	double var = 0;
+	for (int j = 0; j < CI_BATCHES; ++j)
+		var += (bm[j] - mean) * (bm[j] - mean);
+	var /= CI_BATCHES - 1;
+	f->mean = mean;
+	f->halfWidth = CI_T_QUANTILE * sqrt(var / CI_BATCHES);
+
+	/* Still in the transient phase, or too few bins per batch for
+	 * the batch means to be roughly independent?
+	 */
+	if (best_d > nb / 2 || bsz < MSER_BATCH)
+		return;
+	f->stable = mean > 0 && f->halfWidth <= relWidth * mean;
+}
+
+bool ConvergenceMonitor::writeReport(const string& fn) const
+{
+	FILE* fp = fopen(fn.c_str(), "w");
+	if (fp == NULL) {
+		cerr << "Error:  Cannot write `" << fn << "'.\n";
+		return false;
+	}
+	fprintf(fp, "# converged = %d\n", (int)converged);
+	fprintf(fp, "# stop_time = %.6f\n",
+		converged ? stopTime : Simulator::Now().GetSeconds());
+	fprintf(fp, "# bin_length = %.6f\n", binLength);
+	fprintf(fp, "# min_duration = %.6f\n", minDuration);
+	fprintf(fp, "# rel_width_target = %.6f\n", relWidth);
+	fprintf(fp, "# confidence = 0.95\n");
+	fprintf(fp, "# app_connect_id stable warmup_s mean_bps "
+		"half_width_bps rel_half_width\n");
+	for (const auto& f: flows) {
+		fprintf(fp, "%d %d %.6f %.1f %.1f %.6f\n",
+			f.appConnectId,
+			(int)f.stable,
+			f.warmupBins * binLength,
+			f.mean,
+			f.halfWidth,
+			f.mean > 0 ? f.halfWidth / f.mean : INFINITY);
+	}
+	fclose(fp);
+	return true;
+}
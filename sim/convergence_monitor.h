@@ -0,0 +1,97 @@
+#ifndef CONVERGENCE_MONITOR_H
+#define CONVERGENCE_MONITOR_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ns3_all.h"
+
+/**	Steady state detection on the throughput of connections.
+ *
+ *	Received bytes of each monitored connection are counted in bins
+ *	of fixed simulation time length, giving a throughput time
+ *	series per connection.  After each bin, and once the minimum
+ *	duration has elapsed, every series is tested:
+ *
+ *	 1) The warm-up period is determined with MSER-5:  the series
+ *	    is grouped into batches of 5 bins, and the truncation point
+ *	    minimizing the standard error of the mean of the remaining
+ *	    batches is chosen.  If that point lies in the second half
+ *	    of the series, the series is still in its transient phase.
+ *
+ *	 2) The remaining series is divided into a fixed number of
+ *	    batches, and the batch means give a confidence interval of
+ *	    the steady state throughput.
+ *
+ *	A connection is stable if its warm-up is over and the interval
+ *	half width relative to the mean is below the target.  Once all
+ *	connections are stable, the simulation is stopped.
+ */
+class ConvergenceMonitor {
+public:
+	/**	@param	bin_length
+	 *		Length of the throughput bins (in sec).
+	 *
+	 *	@param	min_duration
+	 *		Never stop before that simulation time (in sec).
+	 *
+	 *	@param	rel_width
+	 *		Target confidence interval half width, relative
+	 *		to the mean.
+	 */
+	ConvergenceMonitor(double bin_length,
+			double min_duration,
+			double rel_width);
+
+	/**	Add a connection to monitor; returns its flow index. */
+	int addFlow(int app_connect_id);
+
+	/**	Account for bytes received on a flow. */
+	void addBytes(int flow, uint32_t bytes)
+	{
+		flows[flow].binBytes += bytes;
+	}
+
+	/**	Start monitoring.  Call before the simulation runs. */
+	void start();
+
+	/**	Write the outcome to a file.  Call after the simulation
+	 *	ran.
+	 */
+	bool writeReport(const std::string& fn) const;
+
+private:
+	struct Flow {
+		int appConnectId;
+
+		/* Bytes received in the current bin */
+		uint64_t binBytes = 0;
+
+		/* Throughput of the completed bins (in bps) */
+		std::vector<double> rates;
+
+		/* Outcome of the latest test */
+		bool stable = false;
+		int warmupBins = 0;
+		double mean = 0;
+		double halfWidth = 0;
+	};
+
+	void closeBin(void);
+
+	/** Test a flow, and update its outcome. */
+	void testFlow(Flow* f) const;
+
+	double binLength;
+	double minDuration;
+	double relWidth;
+
+	std::vector<Flow> flows;
+
+	/** Whether we stopped the simulation */
+	bool converged = false;
+	double stopTime = 0;
+};
+
+#endif /* CONVERGENCE_MONITOR_H */
@@ -0,0 +1,207 @@
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+#include <cxxabi.h>
+
+#include "event_timeline.h"
+#include "io_utils.h"
+
+#include "counting-scheduler.h"
+
+using namespace std;
+using namespace ns3;
+
+/*	Components, and the substrings of EventImpl type names that make
+ *	an event belong to them.  The first match wins, so more specific
+ *	components come first (e.g., OLSR's timers are routing, not MAC).
+ */
+struct componentPatterns {
+	const char* name;
+	vector<const char*> patterns;
+};
+
+static const vector<componentPatterns> component_patterns = {
+	{ "routing",	{ "Olsr", "Aodv", "Hwmp", "PeerManagement",
+			  "PeerLink", "Dot11s", "Routing" } },
+	{ "app",	{ "Application", "RqEncoder", "RqDecoder", "Proxy",
+			  "PacketSink", "OnOff", "BulkSend", "UdpEcho",
+			  "ThreeGpp" } },
+	{ "tcp",	{ "Tcp" } },
+	{ "mac",	{ "Mac", "Txop", "ChannelAccessManager",
+			  "DcfManager", "StationManager", "Minstrel",
+			  "BlockAck" } },
+	{ "phy",	{ "Phy", "WifiChannel", "Interference" } },
+	{ "p2p",	{ "PointToPoint" } },
+	{ "ip",		{ "Ipv4", "Arp", "Udp", "Icmp" } },
+	{ "monitor",	{ "ProgressReport", "EventTimeline",
+			  "ConvergenceMonitor", "MemoryTracker",
+			  "FlowMonitor", "MeshSim" } },
+};
+
+/** Index of the catch-all component */
+static const size_t OTHER = component_patterns.size();
+
+static string demangle(const char* name)
+{
+	int status;
+	char* demangled = abi::__cxa_demangle(name, NULL, NULL, &status);
+	if (status != 0)
+		return name;
+	string r = demangled;
+	free(demangled);
+	return r;
+}
+
+EventTimeline::EventTimeline(double interval)
+	: interval(interval),
+	  lastCounts(OTHER + 1, 0)
+{
+	CountingScheduler::EnableTypeCounts();
+	event = Simulator::Schedule(Seconds(interval),
+		&EventTimeline::Update,
+		this);
+	walltime.Start();
+}
+
+EventTimeline::~EventTimeline()
+{
+	if (fp != NULL)
+		fclose(fp);
+}
+
+bool EventTimeline::open(const string& fn)
+{
+	fp = fopen(fn.c_str(), "w");
+	if (fp == NULL) {
+		cerr << "Error:  Cannot write `" << fn << "'.\n";
+		return false;
+	}
+	fileName = fn;
+
+	fprintf(fp, "# interval = %g\n", interval);
+	fprintf(fp, "# columns = sim_s wall_s events");
+	for (const auto& c: component_patterns)
+		fprintf(fp, " %s", c.name);
+	fprintf(fp, " other\n");
+	return true;
+}
+
+bool EventTimeline::moveTo(const string& out_dir)
+{
+	if (fp == NULL)
+		return true;
+
+	fclose(fp);
+	const string fn = out_dir + "/event_timeline.txt";
+	fp = copyAndReopen(fileName, fn);
+	if (fp == NULL) {
+		/* Error already printed */
+		return false;
+	}
+	fileName = fn;
+	return true;
+}
+
+size_t EventTimeline::componentOf(const type_info* type)
+{
+	auto it = components.find(type);
+	if (it != components.end())
+		return it->second;
+
+	const string name = demangle(type->name());
+	size_t c;
+	for (c = 0; c < OTHER; ++c) {
+		bool match = false;
+		for (const char* p: component_patterns[c].patterns)
+			match = match || name.find(p) != string::npos;
+		if (match)
+			break;
+	}
+	components[type] = c;
+	return c;
+}
+
+void EventTimeline::writeInterval()
+{
+	vector<uint64_t> counts(OTHER + 1, 0);
+	for (const auto& type_count: CountingScheduler::GetTypeCounts())
+		counts[componentOf(type_count.first)] += type_count.second;
+
+	const int64_t wall_ms = walltime.End();
+	const double sim_s = Simulator::Now().GetSeconds();
+	uint64_t total = 0;
+	for (size_t c = 0; c <= OTHER; ++c)
+		total += counts[c] - lastCounts[c];
+
+	if (fp != NULL && sim_s > lastSimS) {
+		fprintf(fp, "%.3f %.3f %llu", sim_s,
+			(wall_ms - lastWallMs) / 1000.0,
+			(unsigned long long)total);
+		for (size_t c = 0; c <= OTHER; ++c) {
+			fprintf(fp, " %llu",
+				(unsigned long long)(counts[c] - lastCounts[c]));
+		}
+		fprintf(fp, "\n");
+		fflush(fp);
+	}
+
+	lastCounts = counts;
+	lastWallMs = wall_ms;
+	lastSimS = sim_s;
+}
+
+void EventTimeline::Update(void)
+{
+	writeInterval();
+
+	/* Schedule next event */
+	event = Simulator::Schedule(Seconds(interval),
+		&EventTimeline::Update,
+		this);
+}
+
+void EventTimeline::finish()
+{
+	Simulator::Cancel(event);
+	writeInterval();
+}
+
+bool EventTimeline::writeTypes(const string& fn)
+{
+	FILE* fp_types = fopen(fn.c_str(), "w");
+	if (fp_types == NULL) {
+		cerr << "Error:  Cannot write `" << fn << "'.\n";
+		return false;
+	}
+
+	/* A type may have several type_infos (e.g., one per shared
+	 * library), so sum up the counts by name
+	 */
+	unordered_map<string, pair<uint64_t, size_t>> by_name;
+	for (const auto& type_count: CountingScheduler::GetTypeCounts()) {
+		auto& e = by_name[demangle(type_count.first->name())];
+		e.first += type_count.second;
+		e.second = componentOf(type_count.first);
+	}
+	vector<pair<uint64_t, string>> sorted;
+	for (const auto& e: by_name)
+		sorted.push_back(make_pair(e.second.first, e.first));
+	sort(sorted.begin(), sorted.end(),
+	     [](const pair<uint64_t, string>& a,
+		const pair<uint64_t, string>& b)
+	     {
+		     return a.first > b.first;
+	     });
+
+	fprintf(fp_types, "# events component type\n");
+	for (const auto& count_type: sorted) {
+		const size_t c = by_name[count_type.second].second;
+		fprintf(fp_types, "%llu %s %s\n",
+			(unsigned long long)count_type.first,
+			c < OTHER ? component_patterns[c].name : "other",
+			count_type.second.c_str());
+	}
+	fclose(fp_types);
+	return true;
+}
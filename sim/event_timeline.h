@@ -0,0 +1,74 @@
+#ifndef EVENT_TIMELINE_H
+#define EVENT_TIMELINE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <typeinfo>
+#include <unordered_map>
+#include <vector>
+
+#include "ns3_all.h"
+
+/**	Time series of the events run, by component.
+ *
+ *	Every interval seconds of simulation time, this appends a line
+ *	to the timeline file with the wall clock time the interval took,
+ *	and the number of events run in it, in total and per component
+ *	(PHY, MAC, routing, TCP, other IP, apps, point-to-point links,
+ *	MeshSim's own monitoring, other).  The component of an event is
+ *	guessed from the type of its EventImpl, i.e., the class of the
+ *	object or the function it calls; this needs the CountingScheduler
+ *	with type counts enabled.
+ *
+ *	At the end, writeTypes() writes the event counts per EventImpl
+ *	type, for a closer look.
+ */
+class EventTimeline {
+public:
+	EventTimeline(double interval);
+	~EventTimeline();
+
+	/**	Write the timeline to the file fn. */
+	bool open(const std::string& fn);
+
+	/**	Continue the timeline in the directory out_dir (for a
+	 *	branch of the simulation).
+	 */
+	bool moveTo(const std::string& out_dir);
+
+	/**	Write the last, partial interval. */
+	void finish();
+
+	/**	Write the event counts per EventImpl type to the file fn. */
+	bool writeTypes(const std::string& fn);
+
+private:
+	void Update(void);
+
+	/**	Write a line for the interval ending now */
+	void writeInterval();
+
+	/**	Component index of an EventImpl type */
+	size_t componentOf(const std::type_info* type);
+
+	ns3::EventId		event;
+	ns3::SystemWallClockMs	walltime;
+	double			interval;
+
+	FILE*			fp = NULL;
+	std::string		fileName;
+
+	/** Wall clock time at the last line, in ms */
+	int64_t			lastWallMs = 0;
+
+	/** Simulation time at the last line, in s */
+	double			lastSimS = 0;
+
+	/** Events per component at the last line */
+	std::vector<uint64_t>	lastCounts;
+
+	std::unordered_map<const std::type_info*, size_t> components;
+};
+
+#endif /* EVENT_TIMELINE_H */
@@ -0,0 +1,178 @@
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "fork_server.h"
+
+using namespace std;
+
+/**	Read a request from the connection conn.
+ *
+ *	On success, fields contains the working directory followed by
+ *	the arguments, and fds the client's stdout and stderr.
+ */
+static bool recvRequest(int conn, vector<string>* fields, int fds[2])
+{
+	string data;
+	char buf[4096];
+
+	/* The first chunk carries the file descriptors */
+	union {
+		char buf[CMSG_SPACE(2 * sizeof(int))];
+		struct cmsghdr align;
+	} control;
+	struct iovec iov = { buf, sizeof(buf) };
+	struct msghdr msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.buf;
+	msg.msg_controllen = sizeof(control.buf);
+
+	ssize_t n = recvmsg(conn, &msg, 0);
+	if (n <= 0) {
+		cerr << "Error:  Fork server request without data.\n";
+		return false;
+	}
+	struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+	if (cmsg == NULL || cmsg->cmsg_level != SOL_SOCKET
+	    || cmsg->cmsg_type != SCM_RIGHTS
+	    || cmsg->cmsg_len != CMSG_LEN(2 * sizeof(int)))
+	{
+		cerr << "Error:  Fork server request without stdout and "
+		  "stderr.\n";
+		return false;
+	}
+	memcpy(fds, CMSG_DATA(cmsg), 2 * sizeof(int));
+	data.append(buf, n);
+
+	/* Read the rest, until the client shuts down its side */
+	while ((n = recv(conn, buf, sizeof(buf), 0)) != 0) {
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			perror("Error:  recv");
+			return false;
+		}
+		data.append(buf, n);
+	}
+
+	/* Split at the NULs */
+	if (data.empty() || data.back() != '\0') {
+		cerr << "Error:  Truncated fork server request.\n";
+		return false;
+	}
+	size_t start = 0;
+	while (start < data.size()) {
+		size_t end = data.find('\0', start);
+		fields->push_back(data.substr(start, end - start));
+		start = end + 1;
+	}
+	return true;
+}
+
+/**	Handle the client on conn, in a freshly forked child. */
+static void serveClient(int conn, RunSimFunction run_sim)
+{
+	/* Branches of the simulation need to wait for their children */
+	signal(SIGCHLD, SIG_DFL);
+
+	vector<string> fields;
+	int fds[2];
+	if (!recvRequest(conn, &fields, fds)) {
+		/* Error already printed */
+		exit(EXIT_FAILURE);
+	}
+
+	/* Take on the client's environment */
+	if (dup2(fds[0], STDOUT_FILENO) < 0
+	    || dup2(fds[1], STDERR_FILENO) < 0)
+	{
+		perror("Error:  dup2");
+		exit(EXIT_FAILURE);
+	}
+	close(fds[0]);
+	close(fds[1]);
+	if (chdir(fields[0].c_str()) < 0) {
+		perror("Error:  chdir");
+		exit(EXIT_FAILURE);
+	}
+
+	/* Run */
+	vector<char*> argv;
+	argv.push_back((char*)"mesh_sim");
+	for (size_t i = 1; i < fields.size(); ++i)
+		argv.push_back(&fields[i][0]);
+	argv.push_back(NULL);
+	const int status = run_sim((int)argv.size() - 1, argv.data());
+
+	/* Report back */
+	fflush(NULL);
+	const string reply = "exit " + to_string(status) + "\n";
+	if (write(conn, reply.data(), reply.size()) < 0)
+		perror("Error:  write");
+	close(conn);
+	exit(status);
+}
+
+int runForkServer(const string& socket_path, RunSimFunction run_sim)
+{
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (socket_path.size() >= sizeof(addr.sun_path)) {
+		cerr << "Error:  Socket path \"" << socket_path
+		  << "\" too long.\n";
+		return EXIT_FAILURE;
+	}
+	strcpy(addr.sun_path, socket_path.c_str());
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		perror("Error:  socket");
+		return EXIT_FAILURE;
+	}
+	unlink(socket_path.c_str());
+	if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0
+	    || listen(fd, 64) < 0)
+	{
+		perror("Error:  Cannot listen on socket");
+		close(fd);
+		return EXIT_FAILURE;
+	}
+
+	/* Don't leave zombies behind */
+	signal(SIGCHLD, SIG_IGN);
+
+	cout << "Fork server listening on " << socket_path << ".\n";
+	for (;;) {
+		int conn = accept(fd, NULL, NULL);
+		if (conn < 0) {
+			if (errno == EINTR)
+				continue;
+			perror("Error:  accept");
+			close(fd);
+			return EXIT_FAILURE;
+		}
+
+		/* Don't have buffered output written twice */
+		fflush(NULL);
+		pid_t pid = fork();
+		if (pid < 0) {
+			perror("Error:  fork");
+		} else if (pid == 0) {
+			close(fd);
+			serveClient(conn, run_sim);
+		}
+		close(conn);
+	}
+}
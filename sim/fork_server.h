@@ -0,0 +1,32 @@
+#ifndef FORK_SERVER_H
+#define FORK_SERVER_H
+
+#include <string>
+
+/**	Function running a simulation for the given command line. */
+typedef int (*RunSimFunction)(int argc, char** argv);
+
+/**	Serve simulation runs on a Unix domain socket.
+ *
+ *	Starting a simulation pays for loading the ns-3 libraries and
+ *	registering all their types; for short runs that is a
+ *	significant part of the total.  The fork server pays for it
+ *	only once: it listens on socket_path, and forks a child for
+ *	every client connecting.  The child runs run_sim as if
+ *	mesh_sim had been started with the client's command line, in
+ *	the client's working directory, and with the client's stdout
+ *	and stderr.
+ *
+ *	Protocol:  The client sends its working directory and then the
+ *	command line arguments (without argv[0]), each terminated by a
+ *	NUL byte, and then shuts down its sending side.  Its stdout
+ *	and stderr descriptors are passed along with the first byte
+ *	(SCM_RIGHTS).  When the run is done, the child answers with
+ *	"exit <status>\n" and closes the connection.  If the run
+ *	crashes, the connection is closed without an answer.
+ *
+ *	This only returns on error.
+ */
+int runForkServer(const std::string& socket_path, RunSimFunction run_sim);
+
+#endif /* FORK_SERVER_H */
@@ -1,5 +1,7 @@
 #include <iostream>
 
+#include <unistd.h>
+
 #include <boost/algorithm/string.hpp>
 
 #include "io_utils.h"
@@ -36,6 +38,43 @@ istream& getconfiglinetokenized(istream& stream,
 	return stream;
 }
 
+FILE* copyAndReopen(const string& from, const string& to)
+{
+	{
+		ifstream in(from, ios::binary);
+		ofstream out(to, ios::binary | ios::trunc);
+		if (!in || !out) {
+			cerr << "Error:  Cannot copy \"" << from << "\" to \""
+			  << to << "\"\n";
+			return NULL;
+		}
+		if (in.peek() != ifstream::traits_type::eof())
+			out << in.rdbuf();
+		if (!out) {
+			cerr << "Error:  Cannot write \"" << to << "\"\n";
+			return NULL;
+		}
+	}
+
+	FILE* fp = fopen(to.c_str(), "a");
+	if (fp == NULL)
+		cerr << "Error:  Cannot open \"" << to << "\"\n";
+	return fp;
+}
+
+long residentSetKb()
+{
+	long size, resident;
+	FILE* fp = fopen("/proc/self/statm", "r");
+	if (fp == NULL)
+		return -1;
+	const int n = fscanf(fp, "%ld %ld", &size, &resident);
+	fclose(fp);
+	if (n != 2)
+		return -1;
+	return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
 bool read_ip_addr(uint32_t& host_ret, const string& addr)
 {
 	uint32_t mask;
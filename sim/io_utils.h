@@ -2,6 +2,7 @@
 #define IO_UTILS_H
 
 #include <cstdint>
+#include <cstdio>
 #include <fstream>
 #include <string>
 #include <vector>
@@ -30,4 +31,15 @@ bool read_ip_network_addr(uint32_t& network_ret,
 		uint32_t& netmask_ret,
 		const std::string& addr);
 
+/**	Copy the file from to the file to, and open the copy for
+ *	appending.
+ *
+ *	Returns the open copy, or NULL on error (in which case an error
+ *	message was printed).
+ */
+FILE* copyAndReopen(const std::string& from, const std::string& to);
+
+/**	Resident set size of this process, in kB (-1 if unknown) */
+long residentSetKb();
+
 #endif /* IO_UTILS_H */
@@ -1,13 +1,14 @@
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 
+#include "fork_server.h"
 #include "mesh_sim.h"
 #include "ns3_all.h"
-#include "progress_report.h"
 
 using namespace std;
 
-int main(int argc, char** argv)
+static int runSim(int argc, char** argv)
 {
 	/* Command line processing */
 	MeshSim sim;
@@ -36,8 +37,21 @@ int main(int argc, char** argv)
 
 	/* Run the sim */
 	cout << "Running the Simulation.\n";
-	ProgressReport pr;
-	sim.Run();
+	if (!sim.Run())
+		return EXIT_FAILURE;
 
 	return 0;
 }
+
+int main(int argc, char** argv)
+{
+	/* Fork server mode:  mesh_sim --server=<socket> */
+	static const char server_opt[] = "--server=";
+	if (argc == 2 && strncmp(argv[1], server_opt,
+				sizeof(server_opt) - 1) == 0)
+	{
+		return runForkServer(argv[1] + sizeof(server_opt) - 1, runSim);
+	}
+
+	return runSim(argc, argv);
+}
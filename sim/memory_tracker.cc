@@ -0,0 +1,291 @@
+#include <algorithm>
+#include <iostream>
+
+#include <ns3/mesh-point-device.h>
+#include <ns3/point-to-point-net-device.h>
+#include <ns3/pointer.h>
+#include <ns3/queue-disc.h>
+#include <ns3/queue.h>
+#include <ns3/tcp-rx-buffer.h>
+#include <ns3/tcp-socket-base.h>
+#include <ns3/tcp-tx-buffer.h>
+#include <ns3/traffic-control-layer.h>
+#include <ns3/wifi-mac.h>
+#include <ns3/wifi-net-device.h>
+
+#include "io_utils.h"
+#include "memory_tracker.h"
+
+#include "bulk-send-application.h"
+#include "packet-sink.h"
+#include "proxy-base.h"
+
+using namespace std;
+using namespace ns3;
+
+/** Columns of the time series, after sim_s */
+enum {
+	COL_RSS_KB,
+	COL_WIFI_PKTS,
+	COL_WIFI_BYTES,
+	COL_WIFI_MAX_NODE_PKTS,
+	COL_QDISC_PKTS,
+	COL_QDISC_BYTES,
+	COL_P2P_PKTS,
+	COL_P2P_BYTES,
+	COL_TCP_TX_BYTES,
+	COL_TCP_RX_BYTES,
+	COL_SOCK_RX_BYTES,
+	COL_PROXY_PKTS,
+	COL_PROXY_BYTES,
+	N_COLS
+};
+
+static const char* column_names[N_COLS] = {
+	"rss_kb",
+	"wifi_pkts", "wifi_bytes", "wifi_max_node_pkts",
+	"qdisc_pkts", "qdisc_bytes",
+	"p2p_pkts", "p2p_bytes",
+	"tcp_tx_bytes", "tcp_rx_bytes", "sock_rx_bytes",
+	"proxy_pkts", "proxy_bytes",
+};
+
+/** Number of nodes listed in the peak report */
+static const size_t TOP_NODES = 10;
+
+/** Attributes of the wifi MACs holding their Txops */
+static const char* txop_attributes[] = {
+	"Txop", "VO_Txop", "VI_Txop", "BE_Txop", "BK_Txop"
+};
+
+/**	Add the packets and bytes in the queue of attribute name of
+ *	object obj (if there is one) to packets and bytes.
+ */
+static void addQueue(Ptr<Object> obj, const char* name,
+		uint64_t* packets, uint64_t* bytes)
+{
+	PointerValue ptr;
+	if (!obj->GetAttributeFailSafe(name, ptr))
+		return;
+	Ptr<QueueBase> queue = ptr.Get<QueueBase>();
+	if (queue == NULL)
+		return;
+	*packets += queue->GetNPackets();
+	*bytes += queue->GetNBytes();
+}
+
+/**	Add the packets and bytes queued in the wifi MAC of dev */
+static void addWifiQueues(Ptr<NetDevice> dev,
+		uint64_t* packets, uint64_t* bytes)
+{
+	Ptr<MeshPointDevice> mp = DynamicCast<MeshPointDevice>(dev);
+	if (mp != NULL) {
+		for (Ptr<NetDevice> iface: mp->GetInterfaces())
+			addWifiQueues(iface, packets, bytes);
+		return;
+	}
+	Ptr<WifiNetDevice> wifi = DynamicCast<WifiNetDevice>(dev);
+	if (wifi == NULL)
+		return;
+	for (const char* name: txop_attributes) {
+		PointerValue ptr;
+		if (!wifi->GetMac()->GetAttributeFailSafe(name, ptr))
+			continue;
+		Ptr<Object> txop = ptr.GetObject();
+		if (txop != NULL)
+			addQueue(txop, "Queue", packets, bytes);
+	}
+}
+
+/**	Add the buffer occupancy of socket to the columns */
+static void addSocket(Ptr<Socket> socket, vector<double>* cols)
+{
+	Ptr<TcpSocketBase> tcp = DynamicCast<TcpSocketBase>(socket);
+	if (tcp != NULL) {
+		(*cols)[COL_TCP_TX_BYTES] += tcp->GetTxBuffer()->Size();
+		(*cols)[COL_TCP_RX_BYTES] += tcp->GetRxBuffer()->Size();
+	} else if (socket != NULL) {
+		(*cols)[COL_SOCK_RX_BYTES] += socket->GetRxAvailable();
+	}
+}
+
+MemoryTracker::MemoryTracker(double interval)
+	: interval(interval),
+	  peaks(N_COLS, 0),
+	  peakTimes(N_COLS, 0)
+{
+	event = Simulator::Schedule(Seconds(interval),
+		&MemoryTracker::Update,
+		this);
+}
+
+MemoryTracker::~MemoryTracker()
+{
+	if (fp != NULL)
+		fclose(fp);
+}
+
+bool MemoryTracker::open(const string& fn)
+{
+	fp = fopen(fn.c_str(), "w");
+	if (fp == NULL) {
+		cerr << "Error:  Cannot write `" << fn << "'.\n";
+		return false;
+	}
+	fileName = fn;
+
+	fprintf(fp, "# interval = %g\n", interval);
+	fprintf(fp, "# columns = sim_s");
+	for (const char* name: column_names)
+		fprintf(fp, " %s", name);
+	fprintf(fp, "\n");
+	return true;
+}
+
+bool MemoryTracker::moveTo(const string& out_dir)
+{
+	if (fp == NULL)
+		return true;
+
+	fclose(fp);
+	const string fn = out_dir + "/memory.txt";
+	fp = copyAndReopen(fileName, fn);
+	if (fp == NULL) {
+		/* Error already printed */
+		return false;
+	}
+	fileName = fn;
+	return true;
+}
+
+void MemoryTracker::sample()
+{
+	const double now = Simulator::Now().GetSeconds();
+	vector<double> cols(N_COLS, 0);
+	cols[COL_RSS_KB] = residentSetKb();
+
+	nodePeaks.resize(NodeList::GetNNodes(), 0);
+	nodePeakTimes.resize(NodeList::GetNNodes(), 0);
+	for (uint32_t i = 0; i < NodeList::GetNNodes(); ++i) {
+		Ptr<Node> node = NodeList::GetNode(i);
+		Ptr<TrafficControlLayer> tc
+			= node->GetObject<TrafficControlLayer>();
+
+		/* Device queues */
+		uint64_t wifi_pkts = 0, wifi_bytes = 0;
+		for (uint32_t j = 0; j < node->GetNDevices(); ++j) {
+			Ptr<NetDevice> dev = node->GetDevice(j);
+			addWifiQueues(dev, &wifi_pkts, &wifi_bytes);
+
+			Ptr<PointToPointNetDevice> p2p
+				= DynamicCast<PointToPointNetDevice>(dev);
+			if (p2p != NULL && p2p->GetQueue() != NULL) {
+				cols[COL_P2P_PKTS] += p2p->GetQueue()->GetNPackets();
+				cols[COL_P2P_BYTES] += p2p->GetQueue()->GetNBytes();
+			}
+
+			Ptr<QueueDisc> qdisc;
+			if (tc != NULL)
+				qdisc = tc->GetRootQueueDiscOnDevice(dev);
+			if (qdisc != NULL) {
+				cols[COL_QDISC_PKTS] += qdisc->GetNPackets();
+				cols[COL_QDISC_BYTES] += qdisc->GetNBytes();
+			}
+		}
+		cols[COL_WIFI_PKTS] += wifi_pkts;
+		cols[COL_WIFI_BYTES] += wifi_bytes;
+		cols[COL_WIFI_MAX_NODE_PKTS]
+			= max<double>(cols[COL_WIFI_MAX_NODE_PKTS], wifi_pkts);
+		if (wifi_pkts > nodePeaks[i]) {
+			nodePeaks[i] = wifi_pkts;
+			nodePeakTimes[i] = now;
+		}
+
+		/* Application sockets and stores */
+		for (uint32_t j = 0; j < node->GetNApplications(); ++j) {
+			Ptr<Application> app = node->GetApplication(j);
+			vector<Ptr<Socket>> sockets;
+			if (auto bulk = DynamicCast<MeshSimBulkSendApplication>(app)) {
+				sockets.push_back(bulk->GetSocket());
+			} else if (auto sink = DynamicCast<MeshSimPacketSink>(app)) {
+				sockets.push_back(sink->GetListeningSocket());
+				for (Ptr<Socket> s: sink->GetAcceptedSockets())
+					sockets.push_back(s);
+			} else if (auto proxy = DynamicCast<ProxyBase>(app)) {
+				proxy->GetSockets(&sockets);
+				uint32_t packets;
+				uint64_t bytes;
+				proxy->GetStoreSize(&packets, &bytes);
+				cols[COL_PROXY_PKTS] += packets;
+				cols[COL_PROXY_BYTES] += bytes;
+			}
+			for (Ptr<Socket> s: sockets)
+				addSocket(s, &cols);
+		}
+	}
+
+	for (int c = 0; c < N_COLS; ++c) {
+		if (cols[c] > peaks[c]) {
+			peaks[c] = cols[c];
+			peakTimes[c] = now;
+		}
+	}
+
+	if (fp == NULL)
+		return;
+	fprintf(fp, "%.3f", now);
+	for (double v: cols)
+		fprintf(fp, " %.0f", v);
+	fprintf(fp, "\n");
+	fflush(fp);
+}
+
+void MemoryTracker::Update(void)
+{
+	sample();
+
+	/* Schedule next event */
+	event = Simulator::Schedule(Seconds(interval),
+		&MemoryTracker::Update,
+		this);
+}
+
+void MemoryTracker::finish()
+{
+	Simulator::Cancel(event);
+	sample();
+}
+
+bool MemoryTracker::writePeaks(const string& fn)
+{
+	FILE* fp_peaks = fopen(fn.c_str(), "w");
+	if (fp_peaks == NULL) {
+		cerr << "Error:  Cannot write `" << fn << "'.\n";
+		return false;
+	}
+
+	fprintf(fp_peaks, "# column peak sim_s\n");
+	for (int c = 0; c < N_COLS; ++c) {
+		fprintf(fp_peaks, "%s %.0f %.3f\n", column_names[c], peaks[c],
+			peakTimes[c]);
+	}
+
+	/* The nodes with the deepest wifi MAC queues */
+	vector<uint32_t> nodes;
+	for (uint32_t i = 0; i < nodePeaks.size(); ++i) {
+		if (nodePeaks[i] > 0)
+			nodes.push_back(i);
+	}
+	sort(nodes.begin(), nodes.end(), [this](uint32_t a, uint32_t b) {
+		return nodePeaks[a] > nodePeaks[b];
+	});
+	if (nodes.size() > TOP_NODES)
+		nodes.resize(TOP_NODES);
+	fprintf(fp_peaks, "# node wifi_pkts sim_s\n");
+	for (uint32_t i: nodes) {
+		fprintf(fp_peaks, "%u %llu %.3f\n", i,
+			(unsigned long long)nodePeaks[i], nodePeakTimes[i]);
+	}
+	fclose(fp_peaks);
+	return true;
+}
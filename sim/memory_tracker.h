@@ -0,0 +1,68 @@
+#ifndef MEMORY_TRACKER_H
+#define MEMORY_TRACKER_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "ns3_all.h"
+
+/**	Time series of where packets are held.
+ *
+ *	Every interval seconds of simulation time, this samples the RSS
+ *	and the packets and bytes held in
+ *
+ *	- the wifi MAC queues (in total, and of the node with the most),
+ *	- the traffic control queue discs and point-to-point device
+ *	  queues,
+ *	- the TCP send and receive buffers, and the receive buffers of
+ *	  other sockets, of MeshSim's bulk send, packet sink and proxy
+ *	  applications,
+ *	- the stores of the proxies themselves (TimedProxy),
+ *
+ *	and appends them as a line to the memory file.  At the end,
+ *	writePeaks() writes the peak of each column, and the nodes with
+ *	the deepest wifi MAC queues.
+ */
+class MemoryTracker {
+public:
+	MemoryTracker(double interval);
+	~MemoryTracker();
+
+	/**	Write the time series to the file fn. */
+	bool open(const std::string& fn);
+
+	/**	Continue the time series in the directory out_dir (for a
+	 *	branch of the simulation).
+	 */
+	bool moveTo(const std::string& out_dir);
+
+	/**	Take a last sample. */
+	void finish();
+
+	/**	Write the peaks to the file fn. */
+	bool writePeaks(const std::string& fn);
+
+private:
+	void Update(void);
+
+	/**	Take a sample, and write it */
+	void sample();
+
+	ns3::EventId		event;
+	double			interval;
+
+	FILE*			fp = NULL;
+	std::string		fileName;
+
+	/** Peak and time of the peak, per column */
+	std::vector<double>	peaks;
+	std::vector<double>	peakTimes;
+
+	/** Peak wifi MAC queue packets and its time, per node */
+	std::vector<uint64_t>	nodePeaks;
+	std::vector<double>	nodePeakTimes;
+};
+
+#endif /* MEMORY_TRACKER_H */
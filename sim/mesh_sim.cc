@@ -1,21 +1,43 @@
+#include <algorithm>
 #include <cstdint>
 #include <cstdio>
+#include <cstdlib>
 #include <iostream>
 #include <sstream>
 #include <unordered_map>
 
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
 #include <boost/algorithm/string.hpp>
 #include <boost/filesystem.hpp>
 #include "mesh_sim.h"
 #include "mobility_config.h"
+#include "mpi_support.h"
+#include "profiler.h"
 #include "ns3_all.h"
 #include "ns3_utils.h"
+#include "pool_allocator.h"
+#include "rng_streams.h"
+#include "scheduler_config.h"
 #include "wifi_config.h"
 
 using namespace ns3;
 using namespace std;
 namespace filesys = boost::filesystem;
 
+static double timevalSec(const struct timeval& tv)
+{
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+MeshSim::~MeshSim()
+{
+	if (useMpi)
+		mpiDisable();
+}
+
 bool MeshSim::ProcessCommandLineArgs(int argc, char** argv)
 {
 	CommandLine cmd;
@@ -39,6 +61,78 @@ bool MeshSim::ProcessCommandLineArgs(int argc, char** argv)
 
 	cmd.AddValue("cwmin",
 		     "Contention window minimum", cwmin);
+
+	cmd.AddValue("fixedStreams",
+		"Assign random variable streams by node, device and app, "
+		"so that runs differing in one parameter share randomness",
+		fixedStreams);
+
+	cmd.AddValue("convergence",
+		"Stop early once the throughput of all connections "
+		"converged", convergence);
+	cmd.AddValue("convMinDuration",
+		"Minimum simulation duration with convergence (in sec)",
+		convMinDuration);
+	cmd.AddValue("convRelWidth",
+		"Target 95% confidence interval half width of the "
+		"throughput, relative to the mean", convRelWidth);
+	cmd.AddValue("convBin",
+		"Throughput bin length for the convergence test (in sec)",
+		convBin);
+
+	cmd.AddValue("branches",
+		"File listing branches (<apps-file> <out-dir> per line) "
+		"to fork off at branchTime", branchesFile);
+	cmd.AddValue("branchTime",
+		"Simulation time at which to fork the branches (in sec)",
+		branchTime);
+	cmd.AddValue("branchJobs",
+		"Maximum number of branches running at the same time "
+		"[default: number of CPUs]", branchJobs);
+
+	cmd.AddValue("mpi",
+		"Distribute the simulation over MPI ranks (run with "
+		"mpirun)", useMpi);
+	cmd.AddValue("mpiMinDelay",
+		"With MPI, least delay of point-to-point links, i.e., "
+		"the lookahead between ranks (in sec)", mpiMinDelay);
+	cmd.AddValue("backhaulDelay",
+		"Delay of the backhaul link (in sec)", backhaulDelay);
+	cmd.AddValue("wiredStaDelay",
+		"Delay of the links to the wired STAs (in sec); with MPI, "
+		"wired STAs go to other ranks if it is at least "
+		"mpiMinDelay", wiredStaDelay);
+
+	cmd.AddValue("scheduler",
+		"Event scheduler: map, heap, list, calendar or meshcal",
+		scheduler);
+	cmd.AddValue("schedulerStats",
+		"Write event scheduler statistics to scheduler.txt",
+		schedulerStats);
+
+	cmd.AddValue("progressInterval",
+		"Interval of progress reports (in simulation sec)",
+		progressInterval);
+	cmd.AddValue("progressLog",
+		"Also log the progress as JSON lines to progress.jsonl",
+		progressLog);
+
+	cmd.AddValue("eventTimeline",
+		"Write the events run per progress interval and component "
+		"to event_timeline.txt", eventTimeline);
+
+	cmd.AddValue("memoryTracker",
+		"Write the packets held in queues, socket buffers and "
+		"proxies per progress interval to memory.txt",
+		memoryTracker);
+
+	cmd.AddValue("profile",
+		"Sample the stack while simulating, and write the samples "
+		"to profile.folded and profile_summary.txt", profile);
+	cmd.AddValue("profileHz",
+		"Profiling samples per second (of wall clock time)",
+		profileHz);
+
 	/* Parse */
 	cmd.Parse(argc, argv);
 
@@ -67,6 +161,62 @@ bool MeshSim::ProcessCommandLineArgs(int argc, char** argv)
 	    cerr << "Error: out directory does not exists or is not a directory\n";
 	    return false;
 	}
+
+	if (!branchesFile.empty()) {
+		if (branchTime <= 0 || branchTime >= simDuration) {
+			cerr << "Error:  Branch time needs to be within the "
+			  "simulation duration.\n";
+			return false;
+		}
+		if (enablePcap) {
+			cerr << "Error:  Pcap output is not supported with "
+			  "branches.\n";
+			return false;
+		}
+		if (branchJobs <= 0)
+			branchJobs = max(1L, sysconf(_SC_NPROCESSORS_ONLN));
+	}
+
+	if (backhaulDelay < 0 || wiredStaDelay < 0) {
+		cerr << "Error:  Link delays can't be negative.\n";
+		return false;
+	}
+
+	if (useMpi) {
+		if (!branchesFile.empty() || convergence) {
+			cerr << "Error:  Branches and convergence detection "
+			  "are not supported with MPI.\n";
+			return false;
+		}
+		if (mpiMinDelay <= 0) {
+			cerr << "Error:  MPI needs a positive minimum link "
+			  "delay.\n";
+			return false;
+		}
+		if (!mpiEnable(&argc, &argv)) {
+			/* Error already printed */
+			useMpi = false;
+			return false;
+		}
+	}
+
+	if (progressInterval <= 0) {
+		cerr << "Error:  The progress interval needs to be "
+		  "positive.\n";
+		return false;
+	}
+
+	/* The progress log has the queue size, and the event timeline
+	 * the events per type, which need counting
+	 */
+	const bool count_events = schedulerStats || progressLog
+		|| eventTimeline;
+	if ((scheduler != "map" || count_events)
+	    && !setScheduler(scheduler, count_events))
+	{
+		/* Error already printed */
+		return false;
+	}
 	return true;
 }
 
@@ -105,6 +255,12 @@ bool MeshSim::LoadConfig()
 		/* Error already printed */
 		return false;
 	}
+	if (!branchesFile.empty()
+	    && !loadBranchConfig(&branches, branchesFile))
+	{
+		/* Error already printed */
+		return false;
+	}
 
 	return true;
 }
@@ -136,13 +292,113 @@ bool MeshSim::Run()
 	FlowMonitorHelper flowHelper;
 	flowMonitor = flowHelper.InstallAll();
 
+	progress.reset(new ProgressReport(progressInterval, simDuration,
+		schedulerStats || progressLog, flowMonitor));
+	if (progressLog && !progress->openLog(outDir + "/progress.jsonl")) {
+		/* Error already printed */
+		return false;
+	}
+	if (eventTimeline) {
+		timeline.reset(new EventTimeline(progressInterval));
+		if (!timeline->open(mpiFileName(outDir + "/event_timeline",
+						".txt")))
+		{
+			/* Error already printed */
+			return false;
+		}
+	}
+	if (memoryTracker) {
+		memTracker.reset(new MemoryTracker(progressInterval));
+		if (!memTracker->open(mpiFileName(outDir + "/memory", ".txt"))) {
+			/* Error already printed */
+			return false;
+		}
+	}
+
+	if (convMonitor)
+		convMonitor->start();
+	if (!branches.empty()) {
+		Simulator::Schedule(Seconds(branchTime),
+			&MeshSim::ForkBranches, this);
+	}
+
 	Simulator::Stop(Seconds(simDuration));
+	SystemWallClockMs wallclock;
+	struct rusage ru_start, ru_end;
+	getrusage(RUSAGE_SELF, &ru_start);
+	manifest.startSimulation();
+	if (profile && !profilerStart(profileHz)) {
+		/* Error already printed */
+		return false;
+	}
+	wallclock.Start();
 	Simulator::Run();
+	const double wall_s = wallclock.End() / 1000.0;
+	if (profile)
+		profilerStop();
+	getrusage(RUSAGE_SELF, &ru_end);
+	manifest.endSimulation();
+	progress->finish();
+	progress.reset();
+	if (timeline)
+		timeline->finish();
+	if (memTracker)
+		memTracker->finish();
+
+	if (isBranchParent) {
+		/* The outputs are the branches' */
+		Simulator::Destroy();
+		return branchesSucceeded;
+	}
 
-	flowMonitor->SerializeToXmlFile(outDir + "/flowdata.xml", true, true);
+	if (useMpi) {
+		/* Each rank only sees the flows of its own nodes */
+		flowMonitor->SerializeToXmlFile(
+			mpiFileName(outDir + "/flowdata", ".xml"), true, true);
+
+		const double cpu_s =
+		  timevalSec(ru_end.ru_utime) - timevalSec(ru_start.ru_utime)
+		  + timevalSec(ru_end.ru_stime) - timevalSec(ru_start.ru_stime);
+		mpiWriteStats(outDir + "/mpi_stats.txt",
+			Simulator::GetEventCount(), wall_s, cpu_s);
+	} else {
+		flowMonitor->SerializeToXmlFile(outDir + "/flowdata.xml",
+						true, true);
+	}
+	if (convMonitor)
+		convMonitor->writeReport(outDir + "/convergence.txt");
+	if (timeline) {
+		timeline->writeTypes(mpiFileName(outDir + "/event_types",
+						 ".txt"));
+		timeline.reset();
+	}
+	if (memTracker) {
+		memTracker->writePeaks(mpiFileName(outDir + "/memory_peaks",
+						   ".txt"));
+		memTracker.reset();
+	}
+	if (schedulerStats && mpiRank() == 0) {
+		writeSchedulerStats(outDir + "/scheduler.txt", scheduler,
+			Simulator::GetEventCount(), wall_s);
+	}
+	if (string(allocatorName()) != "system")
+		writeAllocatorStats(mpiFileName(outDir + "/allocator", ".txt"));
 
 	Simulator::Destroy();
-	return true;
+
+	manifest.setCount("mesh_nodes", meshNodes.GetN());
+	manifest.setCount("stas", staNodes.GetN());
+	manifest.setCount("wired_stas", wiredStaNodes.GetN());
+	manifest.setCount("backhaul_nodes", backhaulNodes.GetN());
+	if (profile && !profilerWrite(
+		mpiFileName(outDir + "/profile", ".folded"),
+		mpiFileName(outDir + "/profile_summary", ".txt")))
+	{
+		/* Error already printed */
+		return false;
+	}
+	return manifest.write(mpiFileName(outDir + "/run_manifest", ".json"),
+			      outDir);
 }
 
 /*********/
@@ -155,14 +411,24 @@ bool MeshSim::CreateChannels()
 	YansWifiChannelHelper meshChannelHelper;
 	if (!configureWifiChannel(&meshChannelHelper, meshWifiConfig))
 		return false;
-	meshPhy.SetChannel(meshChannelHelper.Create());
+	Ptr<YansWifiChannel> meshChannel = meshChannelHelper.Create();
+	if (fixedStreams) {
+		meshChannelHelper.AssignStreams(meshChannel,
+				rngStreamBase(RNG_MESH_CHANNEL, 0));
+	}
+	meshPhy.SetChannel(meshChannel);
 
 	// Setup staPhy helper
 	staPhy = YansWifiPhyHelper::Default();
 	YansWifiChannelHelper staChannelHelper;
 	if (!configureWifiChannel(&staChannelHelper, apStaWifiConfig))
 		return false;
-	staPhy.SetChannel(staChannelHelper.Create());
+	Ptr<YansWifiChannel> staChannel = staChannelHelper.Create();
+	if (fixedStreams) {
+		staChannelHelper.AssignStreams(staChannel,
+				rngStreamBase(RNG_STA_CHANNEL, 0));
+	}
+	staPhy.SetChannel(staChannel);
 
 	// Configure AP<->STA wifi
 	if (!configureWifiStdAndRateControl(&apStaWifi, apStaWifiConfig))
@@ -172,10 +438,22 @@ bool MeshSim::CreateChannels()
 
 	// Create Point-to-point channel helper
 	backhaulP2pHelper.SetDeviceAttribute("DataRate", StringValue("1Gbps"));
-	backhaulP2pHelper.SetChannelAttribute("Delay", StringValue("1ms"));
+	backhaulP2pHelper.SetChannelAttribute("Delay",
+		TimeValue(Seconds(backhaulDelay)));
 
 	wiredStaHelper.SetDeviceAttribute("DataRate", StringValue("10Gbps"));
-	wiredStaHelper.SetChannelAttribute("Delay", StringValue("0ms"));
+	wiredStaHelper.SetChannelAttribute("Delay",
+		TimeValue(Seconds(wiredStaDelay)));
+
+	/* Links between ranks need a delay, as that is the lookahead.
+	 * Rather than changing the link, refuse to run.
+	 */
+	if (BackhaulRank() != 0 && backhaulDelay < mpiMinDelay) {
+		cerr << "Error:  The backhaul link delay (" << backhaulDelay
+		  << " s) is below --mpiMinDelay (" << mpiMinDelay
+		  << " s); raise --backhaulDelay or lower --mpiMinDelay.\n";
+		return false;
+	}
 
 	return true;
 }
@@ -214,6 +492,13 @@ bool MeshSim::CreateMesh()
 		    "Ssid", SsidValue(ssid));
 	apDevices = apStaWifi.Install(staPhy, mac, meshNodes);
 
+	if (fixedStreams) {
+		assignRoleStreams(&meshMobilityHelper, meshNodes,
+				RNG_MESH_MOBILITY);
+		assignRoleStreams(&meshHelper, meshDevices, RNG_MESH_DEVICE);
+		assignRoleStreams(&apStaWifi, apDevices, RNG_AP_DEVICE);
+	}
+
 	return true;
 }
 
@@ -232,11 +517,18 @@ void MeshSim::CreateStas()
 		    "Ssid", SsidValue(ssid),
 		    "ActiveProbing", BooleanValue(false));
 	staDevices = apStaWifi.Install(staPhy, mac, staNodes);
+
+	if (fixedStreams) {
+		assignRoleStreams(&staMobilityHelper, staNodes,
+				RNG_STA_MOBILITY);
+		assignRoleStreams(&apStaWifi, staDevices, RNG_STA_DEVICE);
+	}
 }
 
 void MeshSim::CreateWiredStas()
 {
-	wiredStaNodes.Create(staSize);
+	for (int i = 0; i < staSize; ++i)
+		wiredStaNodes.Create(1, WiredStaRank(i));
 	for (int i = 0; i < (int)wiredStaNodes.GetN(); ++i) {
 		Ptr<Node> staNode = staNodes.Get(i);
 		Ptr<Node> wiredStaNode = wiredStaNodes.Get(i);
@@ -250,7 +542,7 @@ void MeshSim::CreateWiredStas()
 void MeshSim::CreateBackhaul()
 {
 	// Create 1 backhaul node
-	backhaulNodes.Create(1);
+	backhaulNodes.Create(1, BackhaulRank());
 
 	// Install network devices
 	backhaulP2pDevices
@@ -315,6 +607,20 @@ void MeshSim::CreateInterfaces()
 	istackHelper.Install(staNodes);
 	istackHelper.Install(wiredStaNodes);
 
+	if (fixedStreams) {
+		/* A role per group of nodes, so that, e.g., more mesh
+		 * nodes don't shift the streams of the STAs
+		 */
+		assignRoleStreams(&istackHelper, meshNodes,
+				RNG_MESH_INTERNET_STACK);
+		assignRoleStreams(&istackHelper, staNodes,
+				RNG_STA_INTERNET_STACK);
+		assignRoleStreams(&istackHelper, backhaulNodes,
+				RNG_BACKHAUL_INTERNET_STACK);
+		assignRoleStreams(&istackHelper, wiredStaNodes,
+				RNG_WIRED_STA_INTERNET_STACK);
+	}
+
 	// Create the Network interfaces, and assign addresses
 	Ipv4AddressHelper addrHelper;
 	addrHelper.SetBase("10.1.1.0", "255.255.255.0");
@@ -389,19 +695,30 @@ void MeshSim::CreateInterfaces()
 	}
 }
 
+void MeshSim::GetAddr2NetDev(AppsManager::Addr2NetDevMapping* addr2netdev)
+{
+	addInterfacesToMap(addr2netdev, backhaulP2pInterfaces);
+	addInterfacesToMap(addr2netdev, meshInterfaces);
+	addInterfacesToMap(addr2netdev, apInterfaces);
+	addInterfacesToMap(addr2netdev, staInterfaces);
+	addInterfacesToMap(addr2netdev, sta2wInterfaces);
+	addInterfacesToMap(addr2netdev, wiredStaInterfaces);
+}
+
 bool MeshSim::InstallApps()
 {
 	/* Compute the map ip_addr -> node */
-	unordered_map< uint32_t, Ptr<NetDevice> > addr2netdev;
-	addInterfacesToMap(&addr2netdev, backhaulP2pInterfaces);
-	addInterfacesToMap(&addr2netdev, meshInterfaces);
-	addInterfacesToMap(&addr2netdev, apInterfaces);
-	addInterfacesToMap(&addr2netdev, staInterfaces);
-	addInterfacesToMap(&addr2netdev, sta2wInterfaces);
-	addInterfacesToMap(&addr2netdev, wiredStaInterfaces);
+	AppsManager::Addr2NetDevMapping addr2netdev;
+	GetAddr2NetDev(&addr2netdev);
 
 	/* Run over all the apps and install them */
 	appsMgr.setOutDir(outDir);
+	appsMgr.setFixedStreams(fixedStreams);
+	if (convergence) {
+		convMonitor.reset(new ConvergenceMonitor(convBin,
+					convMinDuration, convRelWidth));
+		appsMgr.setConvergenceMonitor(convMonitor.get());
+	}
 	if (!appsMgr.createApps(appsCfg, addr2netdev)) {
 		/* Error already printed */
 		return false;
@@ -441,6 +758,12 @@ void MeshSim::PreparePcap()
 		 << '\n';
 
 		for (const auto& addr_dev_pair: addr2dev) {
+			/* With MPI, other ranks capture their own devices */
+			if (addr_dev_pair.second->GetNode()->GetSystemId()
+			    != mpiRank())
+			{
+				continue;
+			}
 			auto meshdev = DynamicCast<MeshPointDevice>(addr_dev_pair.second);
 			ostringstream fn_prefix;
 			fn_prefix << outDir << '/' << v.name_prefix << '-'
@@ -479,3 +802,124 @@ void MeshSim::PreparePcap()
 		}
 	}
 }
+
+/* MPI partitioning
+ *
+ * The wireless part of the network (mesh nodes, their AP devices and
+ * the STAs) shares wifi channels, which ns-3 can't split across
+ * ranks, so it all stays on rank 0.  The nodes behind point-to-point
+ * links, i.e., the backhaul and the wired STAs, are spread over the
+ * other ranks, as long as their link delay is at least mpiMinDelay.
+ * By default, the wired STA links have no delay (--wiredStaDelay), so
+ * these STAs stay on rank 0.  There is no partition of the mesh
+ * itself, so the ranks only share the load of the wired nodes.
+ */
+
+uint32_t MeshSim::BackhaulRank() const
+{
+	return mpiSize() > 1 ? 1 : 0;
+}
+
+uint32_t MeshSim::WiredStaRank(int i) const
+{
+	const uint32_t n = mpiSize();
+	if (n == 1 || wiredStaDelay < mpiMinDelay)
+		return 0;
+	if (n == 2)
+		return 1;
+
+	/* Leave the backhaul rank to the backhaul, if there are enough */
+	return 2 + i % (n - 2);
+}
+
+/*********/
+
+void MeshSim::ForkBranches()
+{
+	/* Don't have buffered output written twice */
+	fflush(NULL);
+
+	int running = 0;
+	for (int i = 0; i < (int)branches.size(); ++i) {
+		/* Wait for a slot */
+		while (running >= branchJobs) {
+			int status;
+			if (wait(&status) < 0)
+				break;
+			--running;
+			if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+				branchesSucceeded = false;
+		}
+
+		pid_t pid = fork();
+		if (pid < 0) {
+			perror("Error:  fork");
+			branchesSucceeded = false;
+			break;
+		}
+		if (pid == 0) {
+			/* Child:  Set up the branch, and go on simulating */
+			if (!StartBranch(branches[i])) {
+				/* Error already printed */
+				fflush(NULL);
+				_exit(EXIT_FAILURE);
+			}
+			return;
+		}
+
+		cout << "Forked branch " << i << " (" << branches[i].outDir
+		  << ") at " << branchTime << " s as process " << pid << ".\n";
+		++running;
+	}
+
+	/* Wait for the remaining children */
+	while (running > 0) {
+		int status;
+		if (wait(&status) < 0)
+			break;
+		--running;
+		if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+			branchesSucceeded = false;
+	}
+
+	isBranchParent = true;
+	Simulator::Stop();
+}
+
+bool MeshSim::StartBranch(const branchConfig& b)
+{
+	/* Only the branch we're in matters from now on */
+	branches.clear();
+
+	/* Output goes to the branch's out directory */
+	if (freopen((b.outDir + "/stdout.txt").c_str(), "w", stdout) == NULL
+	    || freopen((b.outDir + "/stderr.txt").c_str(), "w", stderr) == NULL)
+	{
+		return false;
+	}
+	if (!appsMgr.moveTraces(b.outDir) || !progress->moveLog(b.outDir)
+	    || (timeline && !timeline->moveTo(b.outDir))
+	    || (memTracker && !memTracker->moveTo(b.outDir)))
+	{
+		/* Error already printed */
+		return false;
+	}
+	outDir = b.outDir;
+	manifest.setBranch();
+	if (profile && !profilerRestartAfterFork()) {
+		/* Error already printed */
+		return false;
+	}
+
+	/* Add the apps of this branch */
+	AppsManager::Addr2NetDevMapping addr2netdev;
+	GetAddr2NetDev(&addr2netdev);
+	if (!appsMgr.createApps(b.apps, addr2netdev)) {
+		/* Error already printed */
+		return false;
+	}
+
+	cout << "Branch " << b.appsFileName << " started at "
+	  << Simulator::Now().GetSeconds() << " s.\n";
+	return true;
+}
@@ -1,17 +1,26 @@
 #ifndef MESH_SIM_H
 #define MESH_SIM_H
 
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "apps_config.h"
 #include "apps_manager.h"
+#include "branch_config.h"
+#include "convergence_monitor.h"
+#include "event_timeline.h"
+#include "memory_tracker.h"
+#include "progress_report.h"
 #include "routing_config.h"
+#include "run_manifest.h"
 #include "wifi_config.h"
 
 #include "ns3_all.h"
 
 class MeshSim {
 public:
+	~MeshSim();
 
 	/**	Process command line arguments */
 	bool ProcessCommandLineArgs(int argc, char** argv);
@@ -73,10 +82,101 @@ private:
 	/** Flags related to PCAP generation */
 	bool useRadioTap = false;
 
+	/** Whether to assign random streams by role (see rng_streams.h) */
+	bool fixedStreams = true;
+
+	/** Whether to stop the simulation once the throughput of all
+	 *  connections converged (see convergence_monitor.h)
+	 */
+	bool convergence = false;
+
+	/** Minimum simulation duration with convergence (in sec) */
+	double convMinDuration = 10;
+
+	/** Target relative confidence interval half width */
+	double convRelWidth = 0.05;
+
+	/** Throughput bin length for the convergence test (in sec) */
+	double convBin = 0.1;
+
+	/** File describing the branches to fork off at branchTime, or
+	 *  empty for no branching (see branch_config.h)
+	 */
+	std::string branchesFile;
+
+	/** Simulation time at which to fork the branches (in sec) */
+	double branchTime = 0;
+
+	/** Maximum number of branches running at the same time */
+	int branchJobs = 0;
+
+	/** The branches */
+	std::vector<branchConfig> branches;
+
+	/** Whether this is the process that forked the branches */
+	bool isBranchParent = false;
+
+	/** In the parent, whether all the branches succeeded */
+	bool branchesSucceeded = true;
+
+	/** Whether to run distributed over MPI (see mpi_support.h) */
+	bool useMpi = false;
+
+	/** With MPI, the least delay a point-to-point link needs to
+	 *  connect nodes of different ranks, i.e., the least lookahead
+	 *  between ranks (in sec)
+	 */
+	double mpiMinDelay = 10e-6;
+
+	/** Delays of the backhaul and wired STA links (in sec).  With
+	 *  MPI, the backhaul needs at least mpiMinDelay, and the wired
+	 *  STAs only leave rank 0 with that much.
+	 */
+	double backhaulDelay = 1e-3;
+	double wiredStaDelay = 0;
+
+	/** Event scheduler (see scheduler_config.h) */
+	std::string scheduler = "map";
+
+	/** Whether to write scheduler statistics to scheduler.txt */
+	bool schedulerStats = false;
+
+	/** Progress report interval (in simulation sec) */
+	double progressInterval = 1.0;
+
+	/** Whether to log the progress to progress.jsonl */
+	bool progressLog = false;
+
+	/** Whether to write the event timeline (see event_timeline.h) */
+	bool eventTimeline = false;
+
+	/** Event timeline, while running */
+	std::unique_ptr<EventTimeline> timeline;
+
+	/** Whether to track memory use (see memory_tracker.h) */
+	bool memoryTracker = false;
+
+	/** Memory tracker, while running */
+	std::unique_ptr<MemoryTracker> memTracker;
+
+	/** Whether to run the sampling profiler (see profiler.h) */
+	bool profile = false;
+
+	/** Profiling samples per second */
+	int profileHz = 499;
+
+	/** Progress report, while running */
+	std::unique_ptr<ProgressReport> progress;
+
+	/** Resource usage of the run, for run_manifest.json */
+	RunManifest manifest;
+
 	/* @} */
 
 	AppsManager appsMgr;
 
+	std::unique_ptr<ConvergenceMonitor> convMonitor;
+
 	ns3::Ipv4InterfaceContainer backhaulP2pInterfaces;
 
 	ns3::Ipv4InterfaceContainer meshInterfaces;
@@ -166,9 +266,36 @@ private:
 	/**	Install traffic generating apps. */
 	bool InstallApps();
 
+	/**	Map IP addresses to the net devices they're assigned to */
+	void GetAddr2NetDev(AppsManager::Addr2NetDevMapping* addr2netdev);
+
 	/**	Enable Pcap output (if applicable) */
 	void PreparePcap();
 
+	/**	MPI rank simulating the backhaul node */
+	uint32_t BackhaulRank() const;
+
+	/**	MPI rank simulating wired STA i */
+	uint32_t WiredStaRank(int i) const;
+
+	/**	@} */
+
+	/**	\defgroup SimBranch Methods to branch the sim
+	 *	@{
+	 */
+
+	/**	Fork a process per branch, and wait for them.
+	 *
+	 *	This is scheduled at branchTime.  In the children, it
+	 *	returns after setting up the branch, and the simulation
+	 *	goes on.  The parent stops the simulation once all the
+	 *	children are done.
+	 */
+	void ForkBranches();
+
+	/**	Set up the branch b, in a freshly forked child. */
+	bool StartBranch(const branchConfig& b);
+
 	/**	@} */
 };
 
@@ -0,0 +1,132 @@
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+#include "mpi_support.h"
+#include "ns3_all.h"
+
+#ifdef MESHSIM_ENABLE_MPI
+#include <mpi.h>
+#include <ns3/global-value.h>
+#include <ns3/mpi-interface.h>
+#endif
+
+using namespace std;
+using namespace ns3;
+
+string mpiFileName(const string& prefix, const string& suffix)
+{
+	if (mpiRank() == 0)
+		return prefix + suffix;
+	return prefix + "-" + to_string(mpiRank()) + suffix;
+}
+
+#ifdef MESHSIM_ENABLE_MPI
+
+static bool mpi_enabled = false;
+
+bool mpiEnable(int* argc, char*** argv)
+{
+	GlobalValue::Bind("SimulatorImplementationType",
+		StringValue("ns3::DistributedSimulatorImpl"));
+	MpiInterface::Enable(argc, argv);
+	mpi_enabled = true;
+	return true;
+}
+
+void mpiDisable()
+{
+	if (mpi_enabled) {
+		MpiInterface::Disable();
+		mpi_enabled = false;
+	}
+}
+
+uint32_t mpiRank()
+{
+	return mpi_enabled ? MpiInterface::GetSystemId() : 0;
+}
+
+uint32_t mpiSize()
+{
+	return mpi_enabled ? MpiInterface::GetSize() : 1;
+}
+
+bool mpiWriteStats(const string& fn,
+		uint64_t events,
+		double wall_s,
+		double cpu_s)
+{
+	const uint32_t size = mpiSize();
+	double mine[3] = { (double)events, wall_s, cpu_s };
+	vector<double> all(3 * size);
+	MPI_Gather(mine, 3, MPI_DOUBLE,
+		all.data(), 3, MPI_DOUBLE,
+		0, MPI_COMM_WORLD);
+	if (mpiRank() != 0)
+		return true;
+
+	FILE* fp = fopen(fn.c_str(), "w");
+	if (fp == NULL) {
+		cerr << "Error:  Cannot write `" << fn << "'.\n";
+		return false;
+	}
+
+	/* The wait time is what Simulator::Run took beyond the CPU it
+	 * used; this is mostly waiting for the other ranks.  (It is
+	 * underestimated if the MPI library busy-waits.)
+	 */
+	double max_events = 0, sum_events = 0;
+	for (uint32_t r = 0; r < size; ++r) {
+		max_events = max(max_events, all[3 * r]);
+		sum_events += all[3 * r];
+	}
+	fprintf(fp, "# ranks = %u\n", size);
+	fprintf(fp, "# events_total = %.0f\n", sum_events);
+	fprintf(fp, "# event_imbalance = %.4f\n",
+		sum_events > 0 ? max_events * size / sum_events : 1.0);
+	fprintf(fp, "# rank events wall_s cpu_s wait_s events_per_s\n");
+	for (uint32_t r = 0; r < size; ++r) {
+		const double ev = all[3 * r];
+		const double wall = all[3 * r + 1];
+		const double cpu = all[3 * r + 2];
+		fprintf(fp, "%u %.0f %.3f %.3f %.3f %.0f\n",
+			r, ev, wall, cpu, max(0.0, wall - cpu),
+			wall > 0 ? ev / wall : 0.0);
+	}
+	fclose(fp);
+	return true;
+}
+
+#else /* MESHSIM_ENABLE_MPI */
+
+bool mpiEnable(int* argc, char*** argv)
+{
+	cerr << "Error:  mesh_sim was built without MPI support "
+	  "(MESHSIM_ENABLE_MPI).\n";
+	return false;
+}
+
+void mpiDisable()
+{
+}
+
+uint32_t mpiRank()
+{
+	return 0;
+}
+
+uint32_t mpiSize()
+{
+	return 1;
+}
+
+bool mpiWriteStats(const string& fn,
+		uint64_t events,
+		double wall_s,
+		double cpu_s)
+{
+	return true;
+}
+
+#endif /* MESHSIM_ENABLE_MPI */
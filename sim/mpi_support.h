@@ -0,0 +1,54 @@
+#ifndef MPI_SUPPORT_H
+#define MPI_SUPPORT_H
+
+#include <cstdint>
+#include <string>
+
+/**	\defgroup MpiSupport Distributed simulation over MPI
+ *
+ *	These wrap ns-3's MpiInterface, so the rest of mesh_sim works
+ *	the same whether or not it was built with MPI support
+ *	(MESHSIM_ENABLE_MPI).  Without it, mpiEnable() fails, and the
+ *	others behave as for a single rank.
+ *	@{
+ */
+
+/**	Switch to the distributed simulator and initialize MPI.
+ *
+ *	Needs to be called before anything touches the simulator.
+ */
+bool mpiEnable(int* argc, char*** argv);
+
+/**	Finalize MPI, if enabled. */
+void mpiDisable();
+
+/**	Rank of this process (0 without MPI) */
+uint32_t mpiRank();
+
+/**	Number of ranks (1 without MPI) */
+uint32_t mpiSize();
+
+/**	Name of an output file of this rank:  prefix + suffix on rank 0,
+ *	and prefix + "-<rank>" + suffix on the others.
+ */
+std::string mpiFileName(const std::string& prefix, const std::string& suffix);
+
+/**	Gather per-rank run statistics, and write them on rank 0.
+ *
+ *	@param	events
+ *		Number of events executed by this rank.
+ *
+ *	@param	wall_s
+ *		Wall clock time spent in Simulator::Run.
+ *
+ *	@param	cpu_s
+ *		CPU time spent in Simulator::Run.
+ */
+bool mpiWriteStats(const std::string& fn,
+		uint64_t events,
+		double wall_s,
+		double cpu_s);
+
+/**	@} */
+
+#endif /* MPI_SUPPORT_H */
@@ -13,14 +13,17 @@
 #include <ns3/log.h>
 #include <ns3/mesh-helper.h>
 #include <ns3/mobility-helper.h>
+#include <ns3/node-list.h>
 #include <ns3/olsr-helper.h>
 #include <ns3/point-to-point-helper.h>
+#include <ns3/pointer.h>
 #include <ns3/simulator.h>
 #include <ns3/ssid.h>
 #include <ns3/string.h>
 #include <ns3/system-wall-clock-ms.h>
 #include <ns3/three-gpp-http-client.h>
 #include <ns3/three-gpp-http-server.h>
+#include <ns3/three-gpp-http-variables.h>
 #include <ns3/udp-echo-client.h>
 #include <ns3/udp-echo-helper.h>
 #include <ns3/udp-echo-server.h>
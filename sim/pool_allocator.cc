@@ -0,0 +1,274 @@
+#include <cstdio>
+#include <iostream>
+
+#include "pool_allocator.h"
+
+#ifdef MESHSIM_POOL_ALLOCATOR
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+#include <sys/mman.h>
+#endif
+
+using namespace std;
+
+#ifdef MESHSIM_POOL_ALLOCATOR
+
+/** Largest block served from the pools */
+static const size_t MAX_POOLED = 4096;
+
+/** Number of size classes:  16 by 16 bytes up to 256, then 4 per
+ * doubling up to MAX_POOLED.
+ */
+static const int N_CLASSES = 32;
+
+/** Size of a chunk; each chunk holds blocks of a single class */
+static const size_t CHUNK_SIZE = 1 << 16;
+
+/** Address space reserved for the pools */
+static const size_t REGION_SIZE = (size_t)32 << 30;
+
+static const size_t N_CHUNKS = REGION_SIZE / CHUNK_SIZE;
+
+/*	The region is mapped on first use.  Chunks are handed out to the
+ *	threads in order, and chunkClass tells which class a chunk holds,
+ *	so blocks need no header.
+ */
+static char* region = NULL;
+static atomic<bool> regionFailed(false);
+static atomic<size_t> nextChunk(0);
+static uint8_t chunkClass[N_CHUNKS];
+
+struct freeBlock {
+	freeBlock* next;
+};
+
+struct classStats {
+	uint64_t allocs;
+	uint64_t frees;
+	int64_t live;
+	int64_t peakLive;
+};
+
+/*	Per thread free lists and the unused part of the thread's current
+ *	chunk per class.  All zero initially, so no constructor runs.
+ */
+struct poolCache {
+	freeBlock* freeList[N_CLASSES];
+	char* bump[N_CLASSES];
+	char* bumpEnd[N_CLASSES];
+	classStats stats[N_CLASSES];
+	uint64_t largeAllocs;
+	uint64_t chunks;
+};
+
+static thread_local poolCache cache;
+
+static inline int sizeClass(size_t n)
+{
+	if (n <= 256)
+		return n == 0 ? 0 : (n - 1) >> 4;
+	const int lg = 63 - __builtin_clzll(n - 1);
+	const int sub = ((n - 1) >> (lg - 2)) & 3;
+	return 16 + (lg - 8) * 4 + sub;
+}
+
+static inline size_t classSize(int c)
+{
+	if (c < 16)
+		return (c + 1) << 4;
+	const int lg = 8 + (c - 16) / 4;
+	return (size_t)(5 + (c - 16) % 4) << (lg - 2);
+}
+
+static bool mapRegion()
+{
+	static atomic<char*> mapped(NULL);
+	char* r = mapped.load();
+	if (r == NULL) {
+		void* p = mmap(NULL, REGION_SIZE, PROT_READ | PROT_WRITE,
+			       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+			       -1, 0);
+		if (p == MAP_FAILED) {
+			regionFailed = true;
+			return false;
+		}
+		char* expected = NULL;
+		if (!mapped.compare_exchange_strong(expected, (char*)p)) {
+			/* Another thread was faster */
+			munmap(p, REGION_SIZE);
+		}
+		r = mapped.load();
+	}
+	region = r;
+	return true;
+}
+
+/**	Give the thread a new chunk for class c, or return false if the
+ *	region is used up (or could not be mapped).
+ */
+static bool refill(int c)
+{
+	if (region == NULL && (regionFailed || !mapRegion()))
+		return false;
+	const size_t i = nextChunk.fetch_add(1);
+	if (i >= N_CHUNKS)
+		return false;
+	chunkClass[i] = c;
+	cache.bump[c] = region + i * CHUNK_SIZE;
+	cache.bumpEnd[c] = cache.bump[c]
+		+ CHUNK_SIZE / classSize(c) * classSize(c);
+	++cache.chunks;
+	return true;
+}
+
+static void* poolAlloc(size_t n)
+{
+	if (n > MAX_POOLED) {
+		++cache.largeAllocs;
+		return malloc(n);
+	}
+
+	const int c = sizeClass(n);
+	void* p;
+	if (cache.freeList[c] != NULL) {
+		p = cache.freeList[c];
+		cache.freeList[c] = cache.freeList[c]->next;
+	} else if (cache.bump[c] != cache.bumpEnd[c] || refill(c)) {
+		p = cache.bump[c];
+		cache.bump[c] += classSize(c);
+	} else {
+		++cache.largeAllocs;
+		return malloc(n);
+	}
+
+	classStats& s = cache.stats[c];
+	++s.allocs;
+	if (++s.live > s.peakLive)
+		s.peakLive = s.live;
+	return p;
+}
+
+static void poolFree(void* p)
+{
+	char* cp = (char*)p;
+	if (region == NULL || cp < region || cp >= region + REGION_SIZE) {
+		free(p);
+		return;
+	}
+
+	/* Blocks freed by another thread than the one that allocated them
+	 * go to the freeing thread's list.
+	 */
+	const int c = chunkClass[(cp - region) / CHUNK_SIZE];
+	freeBlock* b = (freeBlock*)p;
+	b->next = cache.freeList[c];
+	cache.freeList[c] = b;
+
+	classStats& s = cache.stats[c];
+	++s.frees;
+	--s.live;
+}
+
+void* operator new(size_t n)
+{
+	void* p = poolAlloc(n);
+	if (p == NULL)
+		throw bad_alloc();
+	return p;
+}
+
+void* operator new[](size_t n)
+{
+	void* p = poolAlloc(n);
+	if (p == NULL)
+		throw bad_alloc();
+	return p;
+}
+
+void* operator new(size_t n, const nothrow_t&) noexcept
+{
+	return poolAlloc(n);
+}
+
+void* operator new[](size_t n, const nothrow_t&) noexcept
+{
+	return poolAlloc(n);
+}
+
+void operator delete(void* p) noexcept
+{
+	poolFree(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	poolFree(p);
+}
+
+void operator delete(void* p, const nothrow_t&) noexcept
+{
+	poolFree(p);
+}
+
+void operator delete[](void* p, const nothrow_t&) noexcept
+{
+	poolFree(p);
+}
+
+const char* allocatorName()
+{
+	return "pool";
+}
+
+bool writeAllocatorStats(const string& fn)
+{
+	FILE* fp = fopen(fn.c_str(), "w");
+	if (fp == NULL) {
+		cerr << "Error:  Cannot write `" << fn << "'.\n";
+		return false;
+	}
+	uint64_t allocs = 0;
+	for (int c = 0; c < N_CLASSES; ++c)
+		allocs += cache.stats[c].allocs;
+	fprintf(fp, "# allocator = pool\n");
+	fprintf(fp, "# region = %s\n", regionFailed ? "unavailable" : "mapped");
+	fprintf(fp, "# chunks = %llu\n", (unsigned long long)cache.chunks);
+	fprintf(fp, "# chunk_kb = %zu\n", CHUNK_SIZE / 1024);
+	fprintf(fp, "# pooled_allocs = %llu\n", (unsigned long long)allocs);
+	fprintf(fp, "# large_allocs = %llu\n",
+		(unsigned long long)cache.largeAllocs);
+	fprintf(fp, "# size allocs frees live peak_live\n");
+	for (int c = 0; c < N_CLASSES; ++c) {
+		const classStats& s = cache.stats[c];
+		fprintf(fp, "%zu %llu %llu %lld %lld\n", classSize(c),
+			(unsigned long long)s.allocs,
+			(unsigned long long)s.frees,
+			(long long)s.live, (long long)s.peakLive);
+	}
+	fclose(fp);
+	return true;
+}
+
+#else /* !MESHSIM_POOL_ALLOCATOR */
+
+const char* allocatorName()
+{
+	return "system";
+}
+
+bool writeAllocatorStats(const string& fn)
+{
+	FILE* fp = fopen(fn.c_str(), "w");
+	if (fp == NULL) {
+		cerr << "Error:  Cannot write `" << fn << "'.\n";
+		return false;
+	}
+	fprintf(fp, "# allocator = system\n");
+	fclose(fp);
+	return true;
+}
+
+#endif /* MESHSIM_POOL_ALLOCATOR */
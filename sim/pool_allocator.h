@@ -0,0 +1,31 @@
+#ifndef POOL_ALLOCATOR_H
+#define POOL_ALLOCATOR_H
+
+#include <string>
+
+/**	\defgroup PoolAllocator Size class pool allocator
+ *
+ *	With MESHSIM_POOL_ALLOCATOR, mesh_sim replaces the global operator
+ *	new and delete (and thereby also those of the ns-3 libraries it
+ *	loads) with a pool allocator:  blocks of up to 4 kB come from
+ *	thread-local free lists per size class, which are refilled from
+ *	64 kB chunks of a single reserved address range.  Larger blocks,
+ *	and everything once the range is used up, go to malloc().  Memory
+ *	of the pools is reused, but never returned to the system.
+ *
+ *	Without MESHSIM_POOL_ALLOCATOR, the system allocator is used, and
+ *	these functions only say so.
+ *	@{
+ */
+
+/**	Name of the allocator in use, "pool" or "system". */
+const char* allocatorName();
+
+/**	Write the allocations of the calling thread per size class to
+ *	the file fn.
+ */
+bool writeAllocatorStats(const std::string& fn);
+
+/** @} */
+
+#endif /* POOL_ALLOCATOR_H */
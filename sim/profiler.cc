@@ -0,0 +1,357 @@
+#include <algorithm>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <map>
+#include <vector>
+
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "profiler.h"
+
+using namespace std;
+
+/** Deepest stack recorded; deeper stacks lose their outermost frames */
+static const int MAX_DEPTH = 64;
+
+/** Frames of the signal handler and trampoline, on top of the sample */
+static const int SKIP_FRAMES = 2;
+
+/** Number of distinct stacks that can be told apart (power of 2) */
+static const size_t TABLE_SIZE = 1 << 16;
+
+/** Slots to probe for a stack before giving up on it */
+static const size_t MAX_PROBE = 64;
+
+struct profStack {
+	uint64_t count;
+	uint64_t hash;
+	int depth;
+	void* frames[MAX_DEPTH];
+};
+
+/*	The table is allocated once, before sampling starts, and then only
+ *	written by the signal handler, which must not allocate.
+ */
+static profStack* table = NULL;
+static volatile sig_atomic_t sampling = 0;
+static uint64_t samples = 0;
+static uint64_t dropped = 0;
+static int sampleHz = 0;
+static timer_t timer;
+static bool haveTimer = false;
+
+static void takeSample(int)
+{
+	if (!sampling)
+		return;
+
+	void* frames[MAX_DEPTH + SKIP_FRAMES];
+	int n = backtrace(frames, MAX_DEPTH + SKIP_FRAMES);
+	void** stack = frames + SKIP_FRAMES;
+	int depth = max(0, n - SKIP_FRAMES);
+
+	/* FNV-1a over the frame addresses */
+	uint64_t hash = 14695981039346656037ULL;
+	for (int i = 0; i < depth; ++i) {
+		hash ^= (uint64_t)(uintptr_t)stack[i];
+		hash *= 1099511628211ULL;
+	}
+
+	++samples;
+	for (size_t probe = 0; probe < MAX_PROBE; ++probe) {
+		profStack& s = table[(hash + probe) & (TABLE_SIZE - 1)];
+		if (s.count == 0) {
+			s.hash = hash;
+			s.depth = depth;
+			memcpy(s.frames, stack, depth * sizeof(void*));
+			s.count = 1;
+			return;
+		}
+		if (s.hash == hash && s.depth == depth
+		    && memcmp(s.frames, stack, depth * sizeof(void*)) == 0)
+		{
+			++s.count;
+			return;
+		}
+	}
+	++dropped;
+}
+
+static bool startTimer()
+{
+	struct sigevent sev;
+	memset(&sev, 0, sizeof(sev));
+	sev.sigev_signo = SIGPROF;
+#ifdef SIGEV_THREAD_ID
+	/* Only the main thread runs the simulation */
+	sev.sigev_notify = SIGEV_THREAD_ID;
+	sev._sigev_un._tid = syscall(SYS_gettid);
+#else
+	sev.sigev_notify = SIGEV_SIGNAL;
+#endif
+	if (timer_create(CLOCK_MONOTONIC, &sev, &timer) < 0) {
+		perror("Error:  timer_create");
+		return false;
+	}
+	haveTimer = true;
+
+	/* tv_nsec needs to stay below 1 s, e.g., at 1 Hz */
+	const int64_t period_ns = 1000000000LL / sampleHz;
+	struct itimerspec its;
+	its.it_interval.tv_sec = period_ns / 1000000000LL;
+	its.it_interval.tv_nsec = period_ns % 1000000000LL;
+	its.it_value = its.it_interval;
+	if (timer_settime(timer, 0, &its, NULL) < 0) {
+		perror("Error:  timer_settime");
+		return false;
+	}
+	sampling = 1;
+	return true;
+}
+
+bool profilerStart(int hz)
+{
+	if (hz <= 0 || hz > 100000) {
+		cerr << "Error:  Invalid profiling rate " << hz << " Hz.\n";
+		return false;
+	}
+	sampleHz = hz;
+
+	if (table == NULL) {
+		table = (profStack*)calloc(TABLE_SIZE, sizeof(profStack));
+		if (table == NULL) {
+			cerr << "Error:  Out of memory for the profiler.\n";
+			return false;
+		}
+	}
+
+	/* The first backtrace() loads libgcc, which allocates; do that
+	 * here rather than in the signal handler.
+	 */
+	void* frame;
+	backtrace(&frame, 1);
+
+	struct sigaction sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = takeSample;
+	sa.sa_flags = SA_RESTART;
+	sigemptyset(&sa.sa_mask);
+	if (sigaction(SIGPROF, &sa, NULL) < 0) {
+		perror("Error:  sigaction");
+		return false;
+	}
+	return startTimer();
+}
+
+void profilerStop()
+{
+	sampling = 0;
+	if (haveTimer) {
+		timer_delete(timer);
+		haveTimer = false;
+	}
+}
+
+bool profilerRestartAfterFork()
+{
+	if (!haveTimer)
+		return true;
+
+	/* The parent's timer is gone in the child */
+	haveTimer = false;
+	return startTimer();
+}
+
+/**	Function name of s, a demangled symbol, without the parameters */
+static string functionName(const string& s)
+{
+	int angle = 0;
+	for (size_t i = 0; i < s.size(); ++i) {
+		if (s[i] == '<') {
+			++angle;
+		} else if (s[i] == '>') {
+			--angle;
+		} else if (s[i] == '(' && angle == 0 && i > 0
+			   && (i < 8 || s.compare(i - 8, 8, "operator") != 0))
+		{
+			return s.substr(0, i);
+		}
+	}
+	return s;
+}
+
+/**	Class of the function called name (or name itself, if it's not a
+ *	member), without namespace and template arguments.
+ */
+static string className(const string& name)
+{
+	/* Drop template arguments */
+	string plain;
+	int angle = 0;
+	for (char c: name) {
+		if (c == '<')
+			++angle;
+		else if (c == '>')
+			--angle;
+		else if (angle == 0)
+			plain += c;
+	}
+	size_t last = plain.rfind("::");
+	if (last == string::npos)
+		return plain;
+	size_t prev = plain.rfind("::", last - 1);
+	return plain.substr(prev == string::npos ? 0 : prev + 2,
+			    last - (prev == string::npos ? 0 : prev + 2));
+}
+
+/**	The ns-3 module of the shared library fn (e.g., wifi for
+ *	libns3.29-wifi-debug.so), or "" if it's not an ns-3 library.
+ */
+static string ns3Module(const string& fn)
+{
+	string base = fn.substr(fn.rfind('/') + 1);
+	if (base.compare(0, 6, "libns3") != 0)
+		return "";
+	size_t dash = base.find('-');
+	if (dash == string::npos)
+		return "";
+	string module = base.substr(dash + 1);
+	if (module.compare(0, 4, "dev-") == 0)
+		module = module.substr(4);
+	module = module.substr(0, module.find(".so"));
+	static const char* profiles[] = { "-debug", "-optimized", "-release",
+					  "-default" };
+	for (const char* p: profiles) {
+		size_t n = strlen(p);
+		if (module.size() > n
+		    && module.compare(module.size() - n, n, p) == 0)
+		{
+			module.resize(module.size() - n);
+		}
+	}
+	return module;
+}
+
+struct frameInfo {
+	/** Name in the collapsed stacks */
+	string name;
+
+	/** Subsystem, if the frame counts for one, or "" */
+	string subsystem;
+
+	/** Shared object */
+	string object;
+};
+
+static const frameInfo& lookupFrame(void* addr,
+		map<void*, frameInfo>* cache)
+{
+	auto it = cache->find(addr);
+	if (it != cache->end())
+		return it->second;
+
+	frameInfo& fi = (*cache)[addr];
+	Dl_info info;
+	if (dladdr(addr, &info) == 0) {
+		fi.name = "[unknown]";
+		return fi;
+	}
+	/* mesh_sim itself is where this function is */
+	static void* self_base = NULL;
+	if (self_base == NULL) {
+		Dl_info self_info;
+		if (dladdr((void*)&profilerWrite, &self_info) != 0)
+			self_base = self_info.dli_fbase;
+	}
+	fi.object = info.dli_fname ? info.dli_fname : "";
+	const string base = fi.object.substr(fi.object.rfind('/') + 1);
+
+	if (info.dli_sname != NULL) {
+		int status;
+		char* demangled = abi::__cxa_demangle(info.dli_sname, NULL,
+						      NULL, &status);
+		fi.name = functionName(status == 0 ? demangled : info.dli_sname);
+		free(demangled);
+	} else {
+		fi.name = "[" + base + "]";
+	}
+
+	const string module = ns3Module(fi.object);
+	if (!module.empty())
+		fi.subsystem = "ns-3 " + module;
+	else if (info.dli_fbase == self_base && info.dli_sname != NULL)
+		fi.subsystem = "mesh_sim " + className(fi.name);
+	return fi;
+}
+
+bool profilerWrite(const string& folded_fn, const string& summary_fn)
+{
+	FILE* fp = fopen(folded_fn.c_str(), "w");
+	if (fp == NULL) {
+		cerr << "Error:  Cannot write `" << folded_fn << "'.\n";
+		return false;
+	}
+
+	map<void*, frameInfo> cache;
+	map<string, uint64_t> by_subsystem;
+	for (size_t i = 0; table != NULL && i < TABLE_SIZE; ++i) {
+		const profStack& s = table[i];
+		if (s.count == 0)
+			continue;
+
+		/* Outermost frame first; return addresses point after the
+		 * call, so look up the byte before (except for the
+		 * interrupted frame).
+		 */
+		string line, subsystem;
+		for (int j = s.depth - 1; j >= 0; --j) {
+			void* addr = j == 0 ? s.frames[j]
+				: (void*)((uintptr_t)s.frames[j] - 1);
+			const frameInfo& fi = lookupFrame(addr, &cache);
+			if (!line.empty())
+				line += ';';
+			line += fi.name;
+			if (!fi.subsystem.empty())
+				subsystem = fi.subsystem;
+		}
+		if (subsystem.empty() && s.depth > 0) {
+			const frameInfo& fi = lookupFrame(s.frames[0], &cache);
+			subsystem = "other " + fi.object.substr(
+				fi.object.rfind('/') + 1);
+		}
+		fprintf(fp, "%s %llu\n", line.c_str(),
+			(unsigned long long)s.count);
+		by_subsystem[subsystem] += s.count;
+	}
+	fclose(fp);
+
+	fp = fopen(summary_fn.c_str(), "w");
+	if (fp == NULL) {
+		cerr << "Error:  Cannot write `" << summary_fn << "'.\n";
+		return false;
+	}
+	vector<pair<uint64_t, string>> sorted;
+	for (const auto& sub: by_subsystem)
+		sorted.push_back(make_pair(sub.second, sub.first));
+	sort(sorted.rbegin(), sorted.rend());
+	fprintf(fp, "# hz = %d\n", sampleHz);
+	fprintf(fp, "# samples = %llu\n", (unsigned long long)samples);
+	fprintf(fp, "# dropped = %llu\n", (unsigned long long)dropped);
+	fprintf(fp, "# samples fraction subsystem\n");
+	for (const auto& sub: sorted) {
+		fprintf(fp, "%llu %.4f %s\n", (unsigned long long)sub.first,
+			samples > 0 ? (double)sub.first / samples : 0.0,
+			sub.second.c_str());
+	}
+	fclose(fp);
+	return true;
+}
@@ -0,0 +1,48 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <string>
+
+/**	\defgroup Profiler Sampling profiler
+ *
+ *	Samples the stack of the main thread hz times per second of wall
+ *	clock time (with a POSIX timer sending SIGPROF), and counts the
+ *	distinct stacks.  The stacks are only symbolized when writing, so
+ *	taking a sample is cheap.
+ *
+ *	Samples are attributed to a subsystem by their innermost frame
+ *	that lies in an ns-3 library ("ns-3 wifi", "ns-3 internet", ...)
+ *	or in mesh_sim itself ("mesh_sim RqEncoder", "mesh_sim AppRxCb",
+ *	...), so that time spent in libc or the C++ library counts for
+ *	its caller.  This relies on ns-3 being built as shared libraries,
+ *	and on mesh_sim exporting its symbols (-rdynamic).
+ *	@{
+ */
+
+/**	Start sampling at hz samples per second */
+bool profilerStart(int hz);
+
+/**	Stop sampling */
+void profilerStop();
+
+/**	Start sampling again in a forked child, with the samples taken
+ *	so far.  (Timers are not inherited over fork.)
+ */
+bool profilerRestartAfterFork();
+
+/**	Write the samples.
+ *
+ *	@param	folded_fn
+ *		File for the samples as collapsed stacks, one line
+ *		"outermost;...;innermost count" per distinct stack, as
+ *		taken by flamegraph.pl.
+ *
+ *	@param	summary_fn
+ *		File for the samples per subsystem.
+ */
+bool profilerWrite(const std::string& folded_fn,
+		const std::string& summary_fn);
+
+/**	@} */
+
+#endif /* PROFILER_H */
@@ -1,30 +1,136 @@
 #include <cstdio>
 
+#include "io_utils.h"
 #include "progress_report.h"
 
+#include "counting-scheduler.h"
+
 using namespace std;
 using namespace ns3;
 
-ProgressReport::ProgressReport()
+ProgressReport::ProgressReport(double update_interval,
+		double sim_duration,
+		bool queue_size,
+		Ptr<FlowMonitor> flow_monitor)
+	: updateInterval(update_interval),
+	  simDuration(sim_duration),
+	  haveQueueSize(queue_size),
+	  flowMonitor(flow_monitor)
 {
-	Simulator::Schedule(Seconds(updateInterval),
+	event = Simulator::Schedule(Seconds(updateInterval),
 		&ProgressReport::Update,
 		this);
 	walltime.Start();
 }
 
-void ProgressReport::Update(void)
+ProgressReport::~ProgressReport()
+{
+	if (log != NULL)
+		fclose(log);
+}
+
+bool ProgressReport::openLog(const string& fn)
+{
+	log = fopen(fn.c_str(), "w");
+	if (log == NULL) {
+		cerr << "Error:  Cannot write `" << fn << "'.\n";
+		return false;
+	}
+	logFileName = fn;
+	return true;
+}
+
+bool ProgressReport::moveLog(const string& out_dir)
+{
+	if (log == NULL)
+		return true;
+
+	fclose(log);
+	const string fn = out_dir + "/progress.jsonl";
+	log = copyAndReopen(logFileName, fn);
+	if (log == NULL) {
+		/* Error already printed */
+		return false;
+	}
+	logFileName = fn;
+	return true;
+}
+
+void ProgressReport::report(bool done)
 {
 	double sim_elapsed = Simulator::Now().GetSeconds();
-	double wall_elapsed = walltime.GetElapsedReal() / 1000.0;
+	/* GetElapsedReal() only returns the time at the last End(), and
+	 * End() leaves the clock running, so read the clock with End().
+	 */
+	double wall_elapsed = walltime.End() / 1000.0;
+	const uint64_t events = Simulator::GetEventCount();
+
+	/* Events per second over the last interval */
+	const double wall_interval = wall_elapsed - lastWall;
+	const double events_per_s = wall_interval > 0
+		? (events - lastEvents) / wall_interval : 0.0;
+	lastEvents = events;
+	lastWall = wall_elapsed;
+
+	/* Packets in flight */
+	int64_t in_flight = 0;
+	for (const auto& flow: flowMonitor->GetFlowStats()) {
+		in_flight += flow.second.txPackets;
+		in_flight -= flow.second.rxPackets + flow.second.lostPackets;
+	}
+
+	const double progress = done ? 1.0 : min(1.0, sim_elapsed / simDuration);
+	const double eta = progress > 0
+		? wall_elapsed * (1 - progress) / progress : -1;
+	const long rss = residentSetKb();
 
 	/* Print status line */
 	printf("+++ Sim time elapsed %6.2f   Wall time elapsed %6.2f  "
 	       "(slowdown %5.2fx)\n",
 	       sim_elapsed, wall_elapsed, wall_elapsed/sim_elapsed);
+	printf("    %10.0f events/s", events_per_s);
+	if (haveQueueSize) {
+		printf("  queue %llu",
+		       (unsigned long long)CountingScheduler::GetSize());
+	}
+	printf("  RSS %ld MB  in flight %lld  ETA %.0f s\n",
+	       rss / 1024, (long long)in_flight, eta);
+
+	if (log == NULL)
+		return;
+
+	fprintf(log, "{\"sim_s\": %.3f, \"wall_s\": %.3f, \"slowdown\": %.3f, "
+		"\"events\": %llu, \"events_per_s\": %.0f, ",
+		sim_elapsed, wall_elapsed,
+		sim_elapsed > 0 ? wall_elapsed / sim_elapsed : 0.0,
+		(unsigned long long)events, events_per_s);
+	if (haveQueueSize) {
+		fprintf(log, "\"queue\": %llu, ",
+			(unsigned long long)CountingScheduler::GetSize());
+	} else {
+		fprintf(log, "\"queue\": null, ");
+	}
+	fprintf(log, "\"rss_kb\": %ld, \"in_flight\": %lld, "
+		"\"progress\": %.4f, \"eta_s\": %.1f, \"done\": %s}\n",
+		rss, (long long)in_flight, progress, eta,
+		done ? "true" : "false");
+
+	/* Whoever watches the log should see it right away */
+	fflush(log);
+}
+
+void ProgressReport::Update(void)
+{
+	report(false);
 
 	/* Schedule next event */
-	Simulator::Schedule(Seconds(1),
+	event = Simulator::Schedule(Seconds(updateInterval),
 		&ProgressReport::Update,
 		this);
 }
+
+void ProgressReport::finish()
+{
+	Simulator::Cancel(event);
+	report(true);
+}
@@ -1,22 +1,89 @@
 #ifndef PROGRESS_REPORT_H
 #define PROGRESS_REPORT_H
 
+#include <cstdint>
+#include <cstdio>
 #include <iostream>
+#include <string>
 
 #include "ns3_all.h"
 
+/**	Periodic progress report of the running simulation.
+ *
+ *	Every updateInterval seconds of simulation time, this prints a
+ *	status line, and optionally appends the same information as a
+ *	JSON object to a log file, one per line:
+ *
+ *	sim_s, wall_s, slowdown:  elapsed simulation and wall clock time,
+ *	  and their ratio
+ *	events, events_per_s:  events executed so far, and per wall clock
+ *	  second during the last interval
+ *	queue:  events pending (null unless the CountingScheduler is used)
+ *	rss_kb:  resident set size of the process
+ *	in_flight:  packets sent by the monitored flows, but neither
+ *	  received nor (yet) declared lost
+ *	progress, eta_s:  fraction of the simulation done, and expected
+ *	  remaining wall clock time at the average speed so far
+ *
+ *	The last line, written by finish(), has "done": true.
+ */
 class ProgressReport {
 public:
-	ProgressReport();
+	/**	Start reporting.
+	 *
+	 *	@param	update_interval
+	 *		Update interval, in simulation time.
+	 *
+	 *	@param	sim_duration
+	 *		Duration of the simulation, for the ETA.
+	 *
+	 *	@param	queue_size
+	 *		Whether the CountingScheduler is in use, so the
+	 *		event queue size is known.
+	 *
+	 *	@param	flow_monitor
+	 *		Flow monitor for the packets in flight.
+	 */
+	ProgressReport(double update_interval,
+		double sim_duration,
+		bool queue_size,
+		ns3::Ptr<ns3::FlowMonitor> flow_monitor);
+	~ProgressReport();
+
+	/**	Append JSON lines to the file fn. */
+	bool openLog(const std::string& fn);
+
+	/**	Continue the log in the directory out_dir (for a branch of
+	 *	the simulation).
+	 */
+	bool moveLog(const std::string& out_dir);
+
+	/**	Write the final report, after the simulation ran. */
+	void finish();
 
 private:
 	void Update(void);
 
+	/**	Print the status line, and log it */
+	void report(bool done);
+
 	ns3::EventId		event;
-	ns3::SystemWallClockMs	walltime;
+	ns3::SystemWallClockMs	walltime;	// Read with End()
 
 	/** Update interval, in simulation time */
 	double			updateInterval = 1.0;
+
+	double			simDuration;
+	bool			haveQueueSize;
+	ns3::Ptr<ns3::FlowMonitor> flowMonitor;
+
+	/** Event count and wall time at the last update */
+	uint64_t		lastEvents = 0;
+	double			lastWall = 0;
+
+	/** The JSON lines log, or NULL */
+	FILE*			log = NULL;
+	std::string		logFileName;
 };
 
 #endif /* PROGRESS_REPORT_H */
@@ -0,0 +1,27 @@
+#include <iostream>
+
+#include "rng_streams.h"
+
+using namespace std;
+
+int64_t rngStreamBase(RngRole role, uint32_t index)
+{
+	return ((int64_t)role * RNG_SLOTS_PER_ROLE
+		+ (int64_t)(index % RNG_SLOTS_PER_ROLE))
+	  * RNG_STREAMS_PER_SLOT;
+}
+
+void checkRngStreamCount(RngRole role, uint32_t index, int64_t used)
+{
+	if (used > RNG_STREAMS_PER_SLOT) {
+		cerr << "Warning:  Object " << index << " of RNG role "
+		  << (int)role << " uses " << used << " random streams, "
+		  "more than the " << RNG_STREAMS_PER_SLOT << " reserved "
+		  "for it; its streams overlap with the next object's.\n";
+	}
+	if (index >= RNG_SLOTS_PER_ROLE) {
+		cerr << "Warning:  More than " << RNG_SLOTS_PER_ROLE
+		  << " objects in RNG role " << (int)role << "; random "
+		  "streams are reused.\n";
+	}
+}
@@ -0,0 +1,79 @@
+#ifndef RNG_STREAMS_H
+#define RNG_STREAMS_H
+
+#include <cstdint>
+
+#include "ns3_all.h"
+
+/**	Deterministic, role based assignment of random variable streams.
+ *
+ *	Left alone, ns-3 numbers the streams of random variables in the
+ *	order in which they are created.  Then any change to the
+ *	configuration that creates one random variable more or less
+ *	shifts the streams of everything created later, and two runs
+ *	that differ in a single parameter see unrelated randomness.
+ *
+ *	Instead, we give each role (mesh devices, AP devices, apps, ...)
+ *	a fixed block of stream numbers, and each object within a role
+ *	(i.e., the i-th node, device or app) a fixed slot within that
+ *	block.  Runs with the same seed and run number then share the
+ *	random numbers of every object that both of them have.
+ */
+enum RngRole {
+	RNG_MESH_CHANNEL = 0,
+	RNG_STA_CHANNEL,
+	RNG_MESH_MOBILITY,
+	RNG_STA_MOBILITY,
+	RNG_MESH_DEVICE,
+	RNG_AP_DEVICE,
+	RNG_STA_DEVICE,
+	RNG_MESH_INTERNET_STACK,
+	RNG_APP,
+	/* New roles go last, so the others keep their streams */
+	RNG_STA_INTERNET_STACK,
+	RNG_BACKHAUL_INTERNET_STACK,
+	RNG_WIRED_STA_INTERNET_STACK,
+};
+
+/**	Number of streams in the slot of a single object */
+const int64_t RNG_STREAMS_PER_SLOT = 256;
+
+/**	Number of object slots per role */
+const int64_t RNG_SLOTS_PER_ROLE = 4096;
+
+/**	First stream of the slot of object index within role. */
+int64_t rngStreamBase(RngRole role, uint32_t index);
+
+/**	Warn if an object used more streams than fit its slot.
+ *
+ *	@param	used
+ *		The number of streams used, as returned by AssignStreams.
+ */
+void checkRngStreamCount(RngRole role, uint32_t index, int64_t used);
+
+/**	Assign streams to each element of a container, one slot each.
+ *
+ *	HelperClass is any ns-3 helper with an AssignStreams(Container,
+ *	int64_t) method, e.g., MobilityHelper, MeshHelper, WifiHelper or
+ *	InternetStackHelper.
+ */
+template<typename HelperClass, typename Container>
+  void assignRoleStreams(HelperClass* helper,
+		const Container& c,
+		RngRole role);
+
+/* Template implementations. */
+
+template<typename HelperClass, typename Container>
+  void assignRoleStreams(HelperClass* helper,
+		const Container& c,
+		RngRole role)
+{
+	for (uint32_t i = 0; i < c.GetN(); ++i) {
+		int64_t used = helper->AssignStreams(Container(c.Get(i)),
+					rngStreamBase(role, i));
+		checkRngStreamCount(role, i, used);
+	}
+}
+
+#endif /* RNG_STREAMS_H */
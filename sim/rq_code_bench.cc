@@ -0,0 +1,207 @@
+/*	Throughput and decoding failure rate of the fountain code of
+ *	RqDecoder's RealCode mode, per K and T.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "fountain-code.h"
+#include "gf256.h"
+
+using namespace std;
+using namespace ns3;
+
+static void usage()
+{
+	cout << "Benchmarks the fountain code of RqDecoder's RealCode mode\n"
+		"\n"
+		"For every K and T, encodes and decodes blocks that lost a\n"
+		"fifth of their source symbols, and reports the encode and\n"
+		"decode throughput (of repair and source data), and the\n"
+		"fraction of blocks that failed to decode with K, K + 1\n"
+		"and K + 2 received symbols.\n"
+		"\n"
+		"  usage: rq_code_bench [-k <Ks>] [-t <Ts>] [-n <blocks>]\n"
+		"\n"
+		"  -h           display this help and exit\n"
+		"  -k <Ks>      comma separated source block sizes [10,100,500]\n"
+		"  -t <Ts>      comma separated symbol sizes [256,1024,1400]\n"
+		"  -n <blocks>  blocks per configuration [100]\n";
+}
+
+static bool parseList(const char* s, vector<uint32_t>* v)
+{
+	v->clear();
+	istringstream in(s);
+	string item;
+	while (getline(in, item, ',')) {
+		char* end;
+		const unsigned long x = strtoul(item.c_str(), &end, 10);
+		if (item.empty() || *end != '\0' || x == 0) {
+			cerr << "Error:  Invalid list `" << s << "'.\n";
+			return false;
+		}
+		v->push_back(x);
+	}
+	return true;
+}
+
+static double seconds(chrono::steady_clock::duration d)
+{
+	return chrono::duration<double>(d).count();
+}
+
+/**	Fraction of blocks that fail to decode from K + extra symbols,
+ *	a random fifth of the source symbols being lost.
+ */
+static double failureRate(uint32_t k, uint32_t extra, uint32_t blocks,
+		mt19937* rng)
+{
+	FountainDecoder dec(k, 0);
+	uint32_t failed = 0;
+	for (uint32_t b = 0; b < blocks; ++b) {
+		dec.Reset();
+		vector<uint32_t> esis;
+		for (uint32_t i = 0; i < k; ++i)
+			esis.push_back(i);
+		shuffle(esis.begin(), esis.end(), *rng);
+		esis.resize(k - k / 5);
+		for (uint32_t i = 0; esis.size() < k + extra; ++i)
+			esis.push_back(k + b * 2 * k + i);
+		for (uint32_t esi: esis)
+			dec.AddSymbol(esi, NULL);
+		if (!dec.IsDecodable())
+			++failed;
+	}
+	return (double)failed / blocks;
+}
+
+static bool benchmark(uint32_t k, uint32_t t, uint32_t blocks, mt19937* rng)
+{
+	FountainCode code(k);
+	FountainDecoder dec(k, t);
+	vector<vector<uint8_t>> source(k, vector<uint8_t>(t));
+	vector<vector<uint8_t>> decoded(k, vector<uint8_t>(t));
+	vector<const uint8_t*> src_ptrs;
+	vector<uint8_t*> dec_ptrs;
+	for (uint32_t i = 0; i < k; ++i) {
+		src_ptrs.push_back(source[i].data());
+		dec_ptrs.push_back(decoded[i].data());
+	}
+	vector<vector<uint8_t>> repair(2 * (k / 5) + 2, vector<uint8_t>(t));
+
+	chrono::steady_clock::duration enc_time(0), dec_time(0);
+	double repair_bytes = 0;
+	for (uint32_t b = 0; b < blocks; ++b) {
+		for (auto& s: source) {
+			for (auto& x: s)
+				x = (*rng)();
+		}
+
+		/* Lose a fifth of the source symbols, and encode twice as
+		 * many repair symbols (in case some aren't innovative)
+		 */
+		vector<uint32_t> lost;
+		for (uint32_t i = 0; i < k; ++i)
+			lost.push_back(i);
+		shuffle(lost.begin(), lost.end(), *rng);
+		lost.resize(k / 5);
+
+		auto start = chrono::steady_clock::now();
+		for (uint32_t i = 0; i < repair.size(); ++i)
+			code.Encode(k + i, src_ptrs.data(), repair[i].data(), t);
+		enc_time += chrono::steady_clock::now() - start;
+		repair_bytes += (double)repair.size() * t;
+
+		vector<bool> is_lost(k, false);
+		for (uint32_t i: lost)
+			is_lost[i] = true;
+		start = chrono::steady_clock::now();
+		dec.Reset();
+		for (uint32_t i = 0; i < k; ++i) {
+			if (!is_lost[i])
+				dec.AddSymbol(i, source[i].data());
+		}
+		for (uint32_t i = 0; !dec.IsDecodable() && i < repair.size();
+		     ++i)
+		{
+			dec.AddSymbol(k + i, repair[i].data());
+		}
+		const bool ok = dec.Decode(dec_ptrs.data());
+		dec_time += chrono::steady_clock::now() - start;
+
+		if (!ok || decoded != source) {
+			cerr << "Error:  Decoding failed for K = " << k
+			     << ", T = " << t << ".\n";
+			return false;
+		}
+	}
+
+	printf("%5u %5u %-7s %9.1f %9.1f %8.4f %8.4f %8.4f\n", k, t,
+		Gf256::GetKernelName(),
+		repair_bytes / 1e6 / seconds(enc_time),
+		(double)blocks * k * t / 1e6 / seconds(dec_time),
+		failureRate(k, 0, blocks * 10, rng),
+		failureRate(k, 1, blocks * 10, rng),
+		failureRate(k, 2, blocks * 10, rng));
+	fflush(stdout);
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	vector<uint32_t> ks = { 10, 100, 500 };
+	vector<uint32_t> ts = { 256, 1024, 1400 };
+	uint32_t blocks = 100;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "hk:t:n:")) != -1) {
+		switch (opt) {
+		case 'h':
+			usage();
+			return EXIT_SUCCESS;
+		case 'k':
+			if (!parseList(optarg, &ks))
+				return EXIT_FAILURE;
+			break;
+		case 't':
+			if (!parseList(optarg, &ts))
+				return EXIT_FAILURE;
+			break;
+		case 'n':
+			blocks = atoi(optarg);
+			if (blocks == 0) {
+				cerr << "Error:  Invalid block count `"
+				     << optarg << "'.\n";
+				return EXIT_FAILURE;
+			}
+			break;
+		default:
+			usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	/* Warm up the GF(256) tables */
+	Gf256::Mul(1, 1);
+
+	mt19937 rng(1);
+	printf("# K     T kernel  enc_MB/s  dec_MB/s   fail_0   fail_1   fail_2\n");
+	for (uint32_t k: ks) {
+		for (uint32_t t: ts) {
+			if (!benchmark(k, t, blocks, &rng))
+				return EXIT_FAILURE;
+		}
+	}
+	return EXIT_SUCCESS;
+}
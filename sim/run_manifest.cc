@@ -0,0 +1,170 @@
+#include <cstdio>
+#include <iostream>
+#include <map>
+
+#include <sys/resource.h>
+
+#include <boost/filesystem.hpp>
+
+#include "build_id.h"
+#include "pool_allocator.h"
+#include "run_manifest.h"
+
+using namespace std;
+using namespace ns3;
+namespace filesys = boost::filesystem;
+
+#ifdef MESHSIM_ENABLE_MPI
+static const bool mpi_build = true;
+#else
+static const bool mpi_build = false;
+#endif
+
+RunManifest::RunManifest()
+{
+	walltime.Start();
+}
+
+void RunManifest::startSimulation()
+{
+	/* End() only reads the clock; it keeps running */
+	simStartMs = walltime.End();
+}
+
+void RunManifest::endSimulation()
+{
+	simEndMs = walltime.End();
+	events = Simulator::GetEventCount();
+
+	uint64_t devices = 0, applications = 0;
+	for (uint32_t i = 0; i < NodeList::GetNNodes(); ++i) {
+		devices += NodeList::GetNode(i)->GetNDevices();
+		applications += NodeList::GetNode(i)->GetNApplications();
+	}
+	setCount("nodes", NodeList::GetNNodes());
+	setCount("devices", devices);
+	setCount("applications", applications);
+}
+
+void RunManifest::setCount(const string& key, uint64_t n)
+{
+	counts.push_back(make_pair(key, n));
+}
+
+/**	s as JSON string */
+static string jsonString(const string& s)
+{
+	string r = "\"";
+	for (char c: s) {
+		if (c == '"' || c == '\\') {
+			r += '\\';
+			r += c;
+		} else if ((unsigned char)c < 0x20) {
+			char buf[8];
+			snprintf(buf, sizeof(buf), "\\u%04x", c);
+			r += buf;
+		} else {
+			r += c;
+		}
+	}
+	return r + '"';
+}
+
+/**	Type of an output file:  its name, up to the first digit (which
+ *	starts connection, node or rank numbers), and its extension.
+ *	E.g., trace-app-rx-12.txt is a trace-app-rx.txt.
+ */
+static string outputType(const string& name)
+{
+	size_t dot = name.rfind('.');
+	if (dot == string::npos)
+		dot = name.size();
+	string stem = name.substr(0, dot);
+	size_t digit = stem.find_first_of("0123456789");
+	if (digit != string::npos && digit > 0) {
+		stem.resize(digit);
+		while (stem.size() > 1
+		       && (stem.back() == '-' || stem.back() == '_'))
+		{
+			stem.pop_back();
+		}
+	}
+	return stem + name.substr(dot);
+}
+
+bool RunManifest::write(const string& fn, const string& out_dir)
+{
+	const int64_t end_ms = walltime.End();
+
+	struct rusage ru;
+	getrusage(RUSAGE_SELF, &ru);
+	const double cpu_s = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6
+		+ ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+
+	/* Output sizes, as far as written */
+	fflush(NULL);
+	map<string, uint64_t> out_bytes;
+	const string manifest_name = filesys::path(fn).filename().string();
+	boost::system::error_code ec;
+	for (filesys::directory_iterator it(out_dir, ec), end;
+	     !ec && it != end; it.increment(ec))
+	{
+		const string name = it->path().filename().string();
+		if (name == manifest_name
+		    || !filesys::is_regular_file(it->status()))
+		{
+			continue;
+		}
+		boost::system::error_code size_ec;
+		const uintmax_t size = filesys::file_size(it->path(), size_ec);
+		if (!size_ec)
+			out_bytes[outputType(name)] += size;
+	}
+	if (ec) {
+		cerr << "Warning:  Cannot list the outputs in `" << out_dir
+		  << "': " << ec.message() << '\n';
+	}
+
+	FILE* fp = fopen(fn.c_str(), "w");
+	if (fp == NULL) {
+		cerr << "Error:  Cannot write `" << fn << "'.\n";
+		return false;
+	}
+	fprintf(fp, "{\n");
+	fprintf(fp, "  \"build\": {\"git\": %s, \"compiler\": %s, "
+		"\"build_type\": %s, \"mpi\": %s, \"allocator\": %s},\n",
+		jsonString(MESHSIM_GIT_DESCRIBE).c_str(),
+		jsonString(MESHSIM_COMPILER).c_str(),
+		jsonString(MESHSIM_BUILD_TYPE).c_str(),
+		mpi_build ? "true" : "false",
+		jsonString(allocatorName()).c_str());
+	fprintf(fp, "  \"branch\": %s,\n", branch ? "true" : "false");
+	fprintf(fp, "  \"wall_s\": {\"setup\": %.3f, \"simulation\": %.3f, "
+		"\"teardown\": %.3f, \"total\": %.3f},\n",
+		simStartMs / 1000.0, (simEndMs - simStartMs) / 1000.0,
+		(end_ms - simEndMs) / 1000.0, end_ms / 1000.0);
+	fprintf(fp, "  \"cpu_s\": %.3f,\n", cpu_s);
+	fprintf(fp, "  \"events\": %llu,\n", (unsigned long long)events);
+	fprintf(fp, "  \"peak_rss_kb\": %ld,\n", (long)ru.ru_maxrss);
+
+	fprintf(fp, "  \"counts\": {");
+	for (size_t i = 0; i < counts.size(); ++i) {
+		fprintf(fp, "%s%s: %llu", i > 0 ? ", " : "",
+			jsonString(counts[i].first).c_str(),
+			(unsigned long long)counts[i].second);
+	}
+	fprintf(fp, "},\n");
+
+	fprintf(fp, "  \"output_bytes\": {");
+	bool first = true;
+	for (const auto& type_bytes: out_bytes) {
+		fprintf(fp, "%s\n    %s: %llu", first ? "" : ",",
+			jsonString(type_bytes.first).c_str(),
+			(unsigned long long)type_bytes.second);
+		first = false;
+	}
+	fprintf(fp, "%s}\n", first ? "" : "\n  ");
+	fprintf(fp, "}\n");
+	fclose(fp);
+	return true;
+}
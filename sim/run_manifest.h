@@ -0,0 +1,63 @@
+#ifndef RUN_MANIFEST_H
+#define RUN_MANIFEST_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ns3_all.h"
+
+/**	Resource usage of a run, written to run_manifest.json.
+ *
+ *	The wall clock time is split into three phases:  setup (from the
+ *	construction of the manifest, through loading the configuration
+ *	and creating the simulation, up to startSimulation()), simulation
+ *	(up to endSimulation()), and teardown (writing the results and
+ *	destroying the simulator, up to write()).  The manifest further
+ *	has the number of events, peak RSS, node, device and application
+ *	counts, the bytes written to the out directory per type of output
+ *	file, and the identity of the mesh_sim build.
+ */
+class RunManifest {
+public:
+	RunManifest();
+
+	/**	End of the setup phase */
+	void startSimulation();
+
+	/**	End of the simulation phase.
+	 *
+	 *	This also takes the event count and the node, device and
+	 *	application counts, which are gone after Simulator::Destroy.
+	 */
+	void endSimulation();
+
+	/**	Add a count of the simulation setup (e.g., "mesh_nodes") */
+	void setCount(const std::string& key, uint64_t n);
+
+	/**	Mark the run as a branch of a shared simulation prefix; its
+	 *	setup and simulation times include the prefix.
+	 */
+	void setBranch() { branch = true; }
+
+	/**	End the teardown phase, and write the manifest to fn.
+	 *
+	 *	@param	out_dir
+	 *		Out directory whose files are counted.
+	 */
+	bool write(const std::string& fn, const std::string& out_dir);
+
+private:
+	ns3::SystemWallClockMs walltime;
+
+	/** Wall clock time at the phase boundaries, in ms */
+	int64_t simStartMs = 0;
+	int64_t simEndMs = 0;
+
+	uint64_t events = 0;
+	std::vector<std::pair<std::string, uint64_t>> counts;
+	bool branch = false;
+};
+
+#endif /* RUN_MANIFEST_H */
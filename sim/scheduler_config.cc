@@ -0,0 +1,68 @@
+#include <cstdio>
+#include <iostream>
+
+#include "ns3_all.h"
+#include "pool_allocator.h"
+#include "scheduler_config.h"
+
+#include "counting-scheduler.h"
+#include "meshsim-calendar-scheduler.h"
+
+using namespace std;
+using namespace ns3;
+
+bool setScheduler(const string& name, bool count)
+{
+	string type;
+	if (name == "map") {
+		type = "ns3::MapScheduler";
+	} else if (name == "heap") {
+		type = "ns3::HeapScheduler";
+	} else if (name == "list") {
+		type = "ns3::ListScheduler";
+	} else if (name == "calendar") {
+		type = "ns3::CalendarScheduler";
+	} else if (name == "meshcal") {
+		/* Also makes sure it gets linked in from ns3_apps */
+		type = MeshSimCalendarScheduler::GetTypeId().GetName();
+	} else {
+		cerr << "Error:  Unknown scheduler \"" << name << "\".\n";
+		return false;
+	}
+
+	ObjectFactory factory;
+	if (count) {
+		factory.SetTypeId(CountingScheduler::GetTypeId());
+		factory.Set("SchedulerType", StringValue(type));
+	} else {
+		factory.SetTypeId(type);
+	}
+	Simulator::SetScheduler(factory);
+	return true;
+}
+
+bool writeSchedulerStats(const string& fn,
+		const string& name,
+		uint64_t events,
+		double wall_s)
+{
+	FILE* fp = fopen(fn.c_str(), "w");
+	if (fp == NULL) {
+		cerr << "Error:  Cannot write `" << fn << "'.\n";
+		return false;
+	}
+	fprintf(fp, "# scheduler = %s\n", name.c_str());
+	fprintf(fp, "# allocator = %s\n", allocatorName());
+	fprintf(fp, "# events = %llu\n", (unsigned long long)events);
+	fprintf(fp, "# wall_s = %.3f\n", wall_s);
+	fprintf(fp, "# events_per_s = %.0f\n",
+		wall_s > 0 ? events / wall_s : 0.0);
+	fprintf(fp, "# inserted = %llu\n",
+		(unsigned long long)CountingScheduler::GetInserted());
+	fprintf(fp, "# cancelled = %llu\n",
+		(unsigned long long)CountingScheduler::GetRemoved());
+	fprintf(fp, "# peak_queue = %llu\n",
+		(unsigned long long)CountingScheduler::GetPeakSize());
+	fclose(fp);
+	return true;
+}
@@ -0,0 +1,29 @@
+#ifndef SCHEDULER_CONFIG_H
+#define SCHEDULER_CONFIG_H
+
+#include <cstdint>
+#include <string>
+
+/**	Make the simulator use the event scheduler called name.
+ *
+ *	The names are map (the ns-3 default), heap, list, calendar (ns-3's
+ *	calendar queue), and meshcal (MeshSimCalendarScheduler, tuned to
+ *	wifi slot timing).  If count is set, the scheduler is wrapped in a
+ *	CountingScheduler, for writeSchedulerStats().
+ */
+bool setScheduler(const std::string& name, bool count);
+
+/**	Write the statistics of a run using scheduler name to file fn.
+ *
+ *	@param	events
+ *		Number of events executed.
+ *
+ *	@param	wall_s
+ *		Wall clock time spent in Simulator::Run.
+ */
+bool writeSchedulerStats(const std::string& fn,
+		const std::string& name,
+		uint64_t events,
+		double wall_s);
+
+#endif /* SCHEDULER_CONFIG_H */